@@ -0,0 +1,39 @@
+#include "arena.h"
+
+// Create a new arena that grabs memory chunk_size bytes at a time
+arena *arena_with_size(size_t chunk_size) {
+  arena *a = (arena *) malloc(sizeof(arena));
+  a->chunks = NULL;
+  a->chunk_size = chunk_size;
+  return a;
+}
+
+// Delete an arena and everything allocated out of it
+void arena_del(arena *a) {
+  arena_chunk *c = a->chunks;
+  while (c != NULL) {
+    arena_chunk *next = c->next;
+    free(c);
+    c = next;
+  }
+  free(a);
+}
+
+// Start a new chunk with room for at least size bytes
+void *arena_alloc_chunk(arena *a, size_t size) {
+  size_t cap = size > a->chunk_size ? size : a->chunk_size;
+  arena_chunk *c = malloc(sizeof(arena_chunk) + cap);
+  c->cap = cap;
+  c->used = size;
+
+  // Anything too big to share a chunk goes behind the current one,
+  // so whatever room is left in it still gets used
+  if (size > a->chunk_size && a->chunks != NULL) {
+    c->next = a->chunks->next;
+    a->chunks->next = c;
+  } else {
+    c->next = a->chunks;
+    a->chunks = c;
+  }
+  return c->data;
+}
@@ -0,0 +1,52 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdlib.h>
+#include <stddef.h>
+
+// Default size of the blocks an arena hands memory out of
+#define ARENA_CHUNK_SIZE 4096
+
+// Block of memory an arena carves allocations out of
+typedef struct ArenaChunk {
+    struct ArenaChunk *next;
+    size_t used;
+    size_t cap;
+    // Keep the data aligned for anything that gets put in it
+    _Alignas(max_align_t) char data[];
+} arena_chunk;
+
+// Region allocator. Allocations are bump-pointer fast and can't be freed one by one,
+// everything in the arena goes away together when it gets deleted
+typedef struct Arena {
+    // Newest chunk first
+    arena_chunk *chunks;
+    size_t chunk_size;
+} arena;
+
+// Create a new arena that grabs memory chunk_size bytes at a time
+arena *arena_with_size(size_t chunk_size);
+
+// Create a new arena
+static inline arena *arena_new() {
+  return arena_with_size(ARENA_CHUNK_SIZE);
+}
+
+// Delete an arena and everything allocated out of it
+void arena_del(arena *a);
+
+// Start a new chunk with room for at least size bytes. Not meant to be called directly
+void *arena_alloc_chunk(arena *a, size_t size);
+
+// Allocate size bytes out of the arena, aligned for any type
+static inline void *arena_alloc(arena *a, size_t size) {
+  size = (size + _Alignof(max_align_t) - 1) & ~(_Alignof(max_align_t) - 1);
+  arena_chunk *c = a->chunks;
+  if (c == NULL || c->cap - c->used < size)
+    return arena_alloc_chunk(a, size);
+  void *p = c->data + c->used;
+  c->used += size;
+  return p;
+}
+
+#endif
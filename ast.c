@@ -0,0 +1,152 @@
+#include "ast.h"
+
+// Name of each kind for printing
+const char *ast_kind_names[AST_KIND_COUNT] = {
+    [AST_EMPTY] = "EMPTY",
+    [AST_PROGRAM] = "PROGRAM",
+    [AST_BLOCK] = "BLOCK",
+    [AST_BODY] = "BODY",
+    [AST_IDENTIFIER_LIST] = "IDENTIFIER_LIST",
+    [AST_ID] = "ID",
+    [AST_DECLARATIONS] = "DECLARATIONS",
+    [AST_VAR] = "VAR",
+    [AST_INTEGER] = "INTEGER",
+    [AST_REAL] = "REAL",
+    [AST_ARRAY] = "ARRAY",
+    [AST_RANGE] = "RANGE",
+    [AST_SUBPROGRAM_DECLARATIONS] = "SUBPROGRAM_DECLARATIONS",
+    [AST_SUBPROGRAM] = "SUBPROGRAM",
+    [AST_FUNCTION] = "FUNCTION",
+    [AST_PROCEDURE] = "PROCEDURE",
+    [AST_PARAMETERS] = "PARAMETERS",
+    [AST_STATEMENT_LIST] = "STATEMENT_LIST",
+    [AST_ASSIGN] = "ASSIGN",
+    [AST_IF] = "IF",
+    [AST_THEN] = "THEN",
+    [AST_WHILE] = "WHILE",
+    [AST_FOR] = "FOR",
+    [AST_DO] = "DO",
+    [AST_CALL] = "CALL",
+    [AST_EXPRESSION_LIST] = "EXPRESSION_LIST",
+    [AST_VARIABLE] = "VARIABLE",
+    [AST_INDEX] = "INDEX",
+    [AST_RELOP] = "RELOP",
+    [AST_ADDOP] = "ADDOP",
+    [AST_SIGN] = "SIGN",
+    [AST_MULOP] = "MULOP",
+    [AST_NOT] = "NOT",
+    [AST_INUM] = "INUM",
+    [AST_RNUM] = "RNUM",
+};
+
+// Create a new empty tree
+ast *ast_new() {
+  ast *t = (ast *) malloc(sizeof(ast));
+  t->kind = NULL;
+  t->left = t->right = NULL;
+  t->value = NULL;
+  t->offset = NULL;
+  t->len = 0;
+  t->cap = 0;
+  t->children = NULL;
+  t->children_len = 0;
+  t->children_cap = 0;
+  t->types = NULL;
+  t->symbols = NULL;
+  // Take up index 0 so it can mean "no node"
+  ast_make(t, AST_EMPTY, 0, AST_NULL, AST_NULL);
+  return t;
+}
+
+// Delete a tree and every node in it
+void ast_del(ast *t) {
+  free(t->kind);
+  free(t->left);
+  free(t->right);
+  free(t->value);
+  free(t->offset);
+  free(t->children);
+  free(t->types);
+  free(t->symbols);
+  free(t);
+}
+
+// Make room for more nodes
+void ast_grow(ast *t) {
+  t->cap = t->cap == 0 ? 256 : t->cap*2;
+  t->kind = realloc(t->kind, sizeof(unsigned char) * t->cap);
+  t->left = realloc(t->left, sizeof(ast_ref) * t->cap);
+  t->right = realloc(t->right, sizeof(ast_ref) * t->cap);
+  t->value = realloc(t->value, sizeof(ast_value) * t->cap);
+  t->offset = realloc(t->offset, sizeof(unsigned int) * t->cap);
+}
+
+// Turn a finished list into a node, deleting the vec
+ast_ref ast_make_list(ast *t, ast_kind kind, unsigned int offset, vec *items) {
+  if (items == NULL)
+    return AST_NULL;
+
+  // Copy the children over to the end of the shared array
+  while (t->children_cap - t->children_len < items->len) {
+    t->children_cap = t->children_cap == 0 ? 256 : t->children_cap*2;
+    t->children = realloc(t->children, sizeof(ast_ref) * t->children_cap);
+  }
+  ast_value v = { .list = { .start = t->children_len, .len = items->len } };
+  for (unsigned int i = 0; i < items->len; ++i)
+    t->children[t->children_len++] = (ast_ref) (uintptr_t) items->data[i];
+  vec_del(items);
+
+  return ast_make_with(t, kind, offset, AST_NULL, AST_NULL, v);
+}
+
+// Make room to annotate every node made so far
+void ast_annotate(ast *t) {
+  free(t->types);
+  free(t->symbols);
+  t->types = calloc(t->len, sizeof(const struct Type *));
+  t->symbols = calloc(t->len, sizeof(unsigned int));
+}
+
+// Print every node of the tree in the order they were made
+void ast_print(const ast *t, FILE *out) {
+  for (ast_ref n = 1; n < t->len; ++n) {
+    fprintf(out, "%u: %s @%u [%u, %u]", n, ast_kind_names[t->kind[n]], t->offset[n], t->left[n], t->right[n]);
+    switch (t->kind[n]) {
+      case AST_PROGRAM:
+      case AST_ID:
+      case AST_FUNCTION:
+      case AST_PROCEDURE:
+      case AST_CALL:
+      case AST_INDEX:
+      case AST_VARIABLE:
+        fprintf(out, " %s", t->value[n].sval);
+        break;
+      case AST_RELOP:
+      case AST_ADDOP:
+      case AST_SIGN:
+      case AST_MULOP:
+        fprintf(out, " op %d", t->value[n].opval);
+        break;
+      case AST_IDENTIFIER_LIST:
+      case AST_DECLARATIONS:
+      case AST_SUBPROGRAM_DECLARATIONS:
+      case AST_PARAMETERS:
+      case AST_STATEMENT_LIST:
+      case AST_EXPRESSION_LIST:
+        fprintf(out, " (");
+        for (unsigned int i = 0; i < ast_list_len(t, n); ++i)
+          fprintf(out, i == 0 ? "%u" : ", %u", ast_list_children(t, n)[i]);
+        fprintf(out, ")");
+        break;
+      case AST_INUM:
+        fprintf(out, " %d", t->value[n].ival);
+        break;
+      case AST_RNUM:
+        fprintf(out, " %f", t->value[n].rval);
+        break;
+      default:
+        break;
+    }
+    fputc('\n', out);
+  }
+}
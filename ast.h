@@ -0,0 +1,185 @@
+#ifndef AST_H
+#define AST_H
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "vec.h"
+
+/*
+ * Flat abstract syntax tree. Every node lives in a set of parallel arrays and
+ * is named by its index, so a node costs 21 bytes and nothing is malloc'd per
+ * node. The parser builds the tree bottom up, which means children always sit
+ * at smaller indices than their parents. Walking the arrays front to back
+ * visits every child before its parent, and back to front visits parents first.
+ * Lists don't chain through left and right. Their children sit next to each
+ * other in one shared array, so walking a list is a loop no matter how long it is
+ */
+
+// Index of a node in its tree
+typedef unsigned int ast_ref;
+
+// Index 0 is never handed out, so it stands in for a missing child
+#define AST_NULL 0
+
+// What a node is. The children each kind uses are listed next to it
+typedef enum AstKind {
+    AST_EMPTY,
+    AST_PROGRAM,                 // value.sval name, left identifier list, right AST_BLOCK
+    AST_BLOCK,                   // left declarations, right AST_BODY
+    AST_BODY,                    // left subprogram declarations, right compound statement
+    AST_IDENTIFIER_LIST,         // list of AST_ID
+    AST_ID,                      // value.sval the identifier
+    AST_DECLARATIONS,            // list of AST_VAR
+    AST_VAR,                     // left identifier list, right type
+    AST_INTEGER,                 // value.type integer
+    AST_REAL,                    // value.type real
+    AST_ARRAY,                   // value.type the whole array type, left AST_RANGE, right element type
+    AST_RANGE,                   // left and right AST_INUM bounds
+    AST_SUBPROGRAM_DECLARATIONS, // list of AST_SUBPROGRAM
+    AST_SUBPROGRAM,              // left head, right AST_BLOCK
+    AST_FUNCTION,                // value.sval name, left arguments, right result type
+    AST_PROCEDURE,               // value.sval name, left arguments
+    AST_PARAMETERS,              // list of AST_VAR
+    AST_STATEMENT_LIST,          // list of statements
+    AST_ASSIGN,                  // left variable, right expression
+    AST_IF,                      // left condition, right AST_THEN
+    AST_THEN,                    // left then branch, right else branch (may be missing)
+    AST_WHILE,                   // left condition, right statement
+    AST_FOR,                     // left AST_ASSIGN, right AST_DO
+    AST_DO,                      // left limit, right statement
+    AST_CALL,                    // value.sval name, left expression list
+    AST_EXPRESSION_LIST,         // list of expressions
+    AST_VARIABLE,                // value.sval the name
+    AST_INDEX,                   // value.sval array name, left index expression
+    AST_RELOP,                   // value.opval operator, left and right operands
+    AST_ADDOP,                   // value.opval operator, left and right operands
+    AST_SIGN,                    // value.opval sign, left operand
+    AST_MULOP,                   // value.opval operator, left and right operands
+    AST_NOT,                     // left operand
+    AST_INUM,                    // value.ival
+    AST_RNUM,                    // value.rval
+    AST_KIND_COUNT
+} ast_kind;
+
+// Payload carried inline by leaves and operators
+typedef union AstValue {
+    int ival;
+    double rval;
+    int opval;
+    char *sval;
+    const struct Type *type;
+    // Where a list's children start in the tree's children array and how many there are
+    struct {
+        unsigned int start;
+        unsigned int len;
+    } list;
+} ast_value;
+
+// A whole tree, stored as one array per field
+typedef struct Ast {
+    unsigned char *kind;
+    ast_ref *left;
+    ast_ref *right;
+    ast_value *value;
+    // Byte offset into the source the node starts at
+    unsigned int *offset;
+    unsigned int len;
+    unsigned int cap;
+    // Children of every list node, each list in one run
+    ast_ref *children;
+    unsigned int children_len;
+    unsigned int children_cap;
+
+    // Worked out by semantic analysis, both NULL until it runs. Indexed like the nodes
+    // Type of every expression
+    const struct Type **types;
+    // Index of the symbol every declared or used identifier resolved to (a symbol_ref)
+    unsigned int *symbols;
+} ast;
+
+// Name of each kind for printing
+extern const char *ast_kind_names[AST_KIND_COUNT];
+
+// Create a new empty tree
+ast *ast_new();
+
+// Delete a tree and every node in it
+void ast_del(ast *t);
+
+// Make room for more nodes. Not meant to be called directly
+void ast_grow(ast *t);
+
+// Add a node with a payload to the tree
+static inline ast_ref ast_make_with(
+    ast *t,
+    ast_kind kind,
+    unsigned int offset,
+    ast_ref left,
+    ast_ref right,
+    ast_value value
+) {
+  if (t->len == t->cap)
+    ast_grow(t);
+  ast_ref n = t->len++;
+  t->kind[n] = kind;
+  t->left[n] = left;
+  t->right[n] = right;
+  t->value[n] = value;
+  t->offset[n] = offset;
+  return n;
+}
+
+// Add a node to the tree
+static inline ast_ref ast_make(ast *t, ast_kind kind, unsigned int offset, ast_ref left, ast_ref right) {
+  return ast_make_with(t, kind, offset, left, right, (ast_value) { .sval = NULL });
+}
+
+/* Lists */
+// Lists are gathered in a vec while the parser is still reading them,
+// then copied into the tree in one go once they are finished
+
+// Add a node to the end of a list being built. A NULL list is an empty one
+static inline vec *ast_list_push(vec *items, ast_ref n) {
+  if (items == NULL)
+    items = vec_with_cap(NULL, NULL, do_not_del, 8);
+  vec_push_back(items, (void *) (uintptr_t) n);
+  return items;
+}
+
+// Turn a finished list into a node, deleting the vec. Empty lists come back as AST_NULL
+ast_ref ast_make_list(ast *t, ast_kind kind, unsigned int offset, vec *items);
+
+// Number of children in a list. AST_NULL counts as an empty list
+static inline unsigned int ast_list_len(const ast *t, ast_ref n) {
+  return t->value[n].list.len;
+}
+
+// Get the children of a list
+static inline ast_ref *ast_list_children(const ast *t, ast_ref n) {
+  return t->children + t->value[n].list.start;
+}
+
+/* Annotations */
+// Make room to annotate every node made so far, all starting out empty
+void ast_annotate(ast *t);
+
+// Get the type of an expression. NULL if it isn't one or it couldn't be worked out
+static inline const struct Type *ast_type(const ast *t, ast_ref n) {
+  return t->types[n];
+}
+
+// Get the index of the symbol an identifier resolved to. 0 if it isn't one or it wasn't found
+static inline unsigned int ast_symbol(const ast *t, ast_ref n) {
+  return t->symbols[n];
+}
+
+// Number of nodes in the tree, not counting AST_NULL
+static inline unsigned int ast_len(const ast *t) {
+  return t->len - 1;
+}
+
+// Print every node of the tree in the order they were made
+void ast_print(const ast *t, FILE *out);
+
+#endif
@@ -48,7 +48,7 @@ unsigned int avl_tree_height(const avl_tree *t) {
   // Find the height of the avl_tree
   for (height = (sizeof(int) * 8) - 1; height > 0; --height) {
     // Found the significant bit in our length
-    if ((t->len & (1 << height)) > 0)
+    if ((t->len & (1u << height)) > 0)
       break;
   }
 
@@ -95,8 +95,9 @@ avl_tree_node *avl_tree_left_rotate(avl_tree_node *r) {
   x->left = r;
   r->right = y;
 
-  //  Update heights
-  r->height -= 2;
+  //  Update heights, r is now below x
+  avl_tree_node_update_height(r);
+  avl_tree_node_update_height(x);
 
   // Return new root
   return x;
@@ -112,8 +113,9 @@ avl_tree_node *avl_tree_right_rotate(avl_tree_node *r) {
   x->right = r;
   r->left = y;
 
-  // Update heights
-  r->height -= 2;
+  // Update heights, r is now below x
+  avl_tree_node_update_height(r);
+  avl_tree_node_update_height(x);
 
   // Return new root
   return x;
@@ -124,6 +126,7 @@ avl_tree_node *avl_tree_right_rotate(avl_tree_node *r) {
 avl_tree_node* avl_tree_insert_from(avl_tree *t, avl_tree_node* node, void *e) {
   /* 1.  Perform the normal BST insertion */
   if (node == NULL) {
+    ++t->len;
     return avl_tree_new_node(e);
   }
 
@@ -141,10 +144,7 @@ avl_tree_node* avl_tree_insert_from(avl_tree *t, avl_tree_node* node, void *e) {
   }
 
   /* 2. Update height of this ancestor node */
-  node->height = max(
-      (void *) avl_tree_node_height(node->left),
-      (void *) avl_tree_node_height(node->right)
-  ) + 1;
+  avl_tree_node_update_height(node);
 
   /* 3. Get the balance factor of this ancestor
         node to check whether this node became
@@ -200,6 +200,8 @@ avl_tree_node* avl_tree_remove_from(avl_tree *t, avl_tree_node* node, void *e) {
     // node with only one child or no child
     if ((node->left == NULL) || (node->right == NULL)) {
       avl_tree_node *temp = node->left ? node->left : node->right;
+      // Hold on to the element since the child might get copied over it
+      void *dead = node->e;
 
       // No child case
       if (temp == NULL) {
@@ -211,17 +213,23 @@ avl_tree_node* avl_tree_remove_from(avl_tree *t, avl_tree_node* node, void *e) {
         *node = *temp;
       }
       // Handle deletion of the node's element
-      t->del(temp->e);
+      t->del(dead);
       // Delete the node
       free(temp);
+      --t->len;
     } else {
       // node with two children: Get the inorder
       // successor (smallest in the right subtree)
-      // Copy the inorder successor's data to this node
-      node->e = avl_tree_min_from(node->right);
+      avl_tree_node *succ = node->right;
+      while (succ->left != NULL)
+        succ = succ->left;
+
+      // Swap the elements. The one being deleted is now smaller than everything
+      // in the right subtree, so searching for it walks straight to the successor
+      swap_ptr(&node->e, &succ->e);
 
       // Delete the inorder successor
-      node->right = avl_tree_remove_from(t, node->right, node->e);
+      node->right = avl_tree_remove_from(t, node->right, e);
     }
   }
 
@@ -230,10 +238,7 @@ avl_tree_node* avl_tree_remove_from(avl_tree *t, avl_tree_node* node, void *e) {
     return node;
 
   // STEP 2: UPDATE HEIGHT OF THE CURRENT NODE
-  node->height = max(
-      (void *) avl_tree_node_height(node->left),
-      (void *) avl_tree_node_height(node->right)
-  ) + 1;
+  avl_tree_node_update_height(node);
 
   // STEP 3: GET THE BALANCE FACTOR OF THIS NODE (to
   // check whether this node became unbalanced)
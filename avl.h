@@ -59,6 +59,13 @@ static inline unsigned int avl_tree_node_height(avl_tree_node* n) {
   return n == NULL ? 0 : n->height;
 }
 
+// Recompute the height of a node from its children
+static inline void avl_tree_node_update_height(avl_tree_node *n) {
+  unsigned int l = avl_tree_node_height(n->left);
+  unsigned int r = avl_tree_node_height(n->right);
+  n->height = (l > r ? l : r) + 1;
+}
+
 // Get height of the avl_tree
 unsigned int avl_tree_height(const avl_tree *t);
 
@@ -94,7 +101,6 @@ avl_tree_node* avl_tree_insert_from(avl_tree *t, avl_tree_node* node, void *e);
 // Simple wrapper for recursive function
 static inline void avl_tree_insert(avl_tree *t, void *e) {
   t->root = avl_tree_insert_from(t, t->root, e);
-  ++t->len;
   t->height = avl_tree_height(t);
 }
 
@@ -105,7 +111,6 @@ avl_tree_node* avl_tree_remove_from(avl_tree *t, avl_tree_node* node, void *e);
 // Simple wrapper for recursive function
 static inline void avl_tree_remove(avl_tree *t, void *e) {
   t->root = avl_tree_remove_from(t, t->root, e);
-  --t->len;
   t->height = avl_tree_height(t);
 }
 
@@ -117,6 +122,44 @@ static inline search_result avl_tree_get(avl_tree *t, const void *e) {
   return avl_tree_get_from(t, t->root, e);
 }
 
+/* Iteration without allocating */
+// Deepest an iterator can go. An AVL tree this tall would need more nodes
+// than fit in memory
+#define AVL_TREE_ITER_DEPTH 64
+
+// In order cursor over the elements of a tree. Keeps its own stack of the
+// nodes it still has to come back to, so it lives entirely on the stack
+typedef struct AVLTreeIter {
+    avl_tree_node *stack[AVL_TREE_ITER_DEPTH];
+    unsigned int depth;
+    bool forward;
+} avl_tree_iter;
+
+// Push a node and everything down its near side onto the iterator's stack
+static inline void avl_tree_iter_descend(avl_tree_iter *it, avl_tree_node *n) {
+  while (n != NULL) {
+    it->stack[it->depth++] = n;
+    n = it->forward ? n->left : n->right;
+  }
+}
+
+// Start a cursor at the smallest (or the largest when walking backwards) element
+static inline void avl_tree_iter_init(avl_tree_iter *it, const avl_tree *t, bool forward) {
+  it->depth = 0;
+  it->forward = forward;
+  avl_tree_iter_descend(it, t->root);
+}
+
+// Move to the next element in order. Returns false once the whole tree has been seen
+static inline bool avl_tree_iter_next(avl_tree_iter *it, void **e) {
+  if (it->depth == 0)
+    return false;
+  avl_tree_node *n = it->stack[--it->depth];
+  avl_tree_iter_descend(it, it->forward ? n->right : n->left);
+  *e = n->e;
+  return true;
+}
+
 // Converts the tree into a sorted list from a certain point in the tree
 void avl_tree_to_list_from(const avl_tree *t, avl_tree_node *n, list *l, bool forward);
 // Converts the tree into a sorted list
@@ -0,0 +1,145 @@
+// flockfile is outside of plain C11
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdarg.h>
+#include "compiler.h"
+#include "semantic.h"
+
+// Create a compiler for the source at path, or stdin if path is NULL, that writes to out and err
+compiler *compiler_new(const char *path, const compiler_options *options, FILE *out, FILE *err) {
+  compiler *c = malloc(sizeof(compiler));
+  c->path = path != NULL ? path : "<stdin>";
+  c->options = *options;
+  c->out = out;
+  c->err = err;
+  // Files get scanned right out of memory, anything else gets streamed
+  if (path == NULL) {
+    source_stdin(&c->input);
+  } else if (source_open(&c->input, path) == -1) {
+    free(c);
+    return NULL;
+  }
+  // Streamed sources get text for the table only if the scanner reads them into memory.
+  // Otherwise their diagnostics fall back to byte offsets
+  c->lines = line_table_new(c->input.data, c->input.len);
+
+  c->identifiers = intern_pool_new();
+  // One arena holds every symbol of the compilation unit
+  c->symbol_arena = arena_new();
+  c->symbols = symbol_array_new();
+  c->syntax_tree = ast_new();
+  c->program = AST_NULL;
+  // Scopes get opened and closed by the semantic pass
+  c->symbol_table = table_stack_new();
+  c->types = type_pool_new();
+
+  c->trace = trace_active != TRACE_OFF ? trace_new(err) : NULL;
+  atomic_init(&c->errors, 0);
+  pthread_mutex_init(&c->report_lock, NULL);
+
+  // The scanner has to be ready before the stream starts pulling tokens out of it
+  c->scanner = scan_new(c);
+  if (source_is_mapped(&c->input))
+    scan_buffer(c->scanner, c->input.data, c->input.len);
+  else
+    scan_stream(c->scanner, c->input.stream);
+  // Tokens only need to stay around once they've been parsed if something is going to look again
+  c->tokens = token_stream_new(c->scanner, options->lex_thread, options->dump_tokens);
+  return c;
+}
+
+// Delete a compiler and everything it made
+void compiler_del(compiler *c) {
+  // The lexer thread has to be done before anything it uses goes away
+  token_stream_del(c->tokens);
+  scan_del(c->scanner);
+  if (c->trace != NULL)
+    trace_del(c->trace);
+  if (c->symbol_table != NULL)
+    table_stack_del(c->symbol_table);
+  type_pool_del(c->types);
+  // Releases every node and symbol in one go
+  ast_del(c->syntax_tree);
+  symbol_array_del(c->symbols);
+  arena_del(c->symbol_arena);
+  intern_pool_del(c->identifiers);
+  line_table_del(c->lines);
+  source_close(&c->input);
+  pthread_mutex_destroy(&c->report_lock);
+  free(c);
+}
+
+// Print every token the parser was handed, without scanning any of them again
+static void compiler_dump_tokens(compiler *c) {
+  token_iter it = token_stream_iter(c->tokens);
+  YYSTYPE value;
+  YYLTYPE offset;
+  int kind;
+  while ((kind = token_iter_next(&it, &value, &offset)) != 0)
+    fprintf(c->out, "token %d @%u\n", kind, offset);
+}
+
+// Parse and check the source
+int compiler_run(compiler *c) {
+  int status = yyparse(c);
+  if (c->options.dump_tokens)
+    compiler_dump_tokens(c);
+  // Checking only makes sense on a whole tree
+  if (status == 0 && c->program != AST_NULL)
+    semantic_check(c, c->program);
+  if (c->options.stats) {
+    table_stack *s = c->symbol_table;
+    fprintf(
+        c->err,
+        "%s: %lu local lookups, %lu skipped by scope signatures (%.1f%%)\n",
+        c->path,
+        s->local_lookups,
+        s->local_skips,
+        s->local_lookups != 0 ? 100.0 * s->local_skips / s->local_lookups : 0.0
+    );
+  }
+  // Everything refers to symbols by index from here on, so the names can go
+  table_stack_del(c->symbol_table);
+  c->symbol_table = NULL;
+  return status != 0 || atomic_load(&c->errors) != 0 ? -1 : 0;
+}
+
+// Print a diagnostic pointing at an offset into the source. The line and column
+// only get worked out here, so nothing else has to keep track of them
+static void report(compiler *c, unsigned int offset, const char *level, const char *fmt, va_list args) {
+  location loc;
+  // The line table gets built by whoever looks something up first. It's built through the
+  // scanner in case it has written into the source
+  pthread_mutex_lock(&c->report_lock);
+  scan_lines(c->scanner, c->lines);
+  int found = line_table_find(c->lines, offset, &loc);
+  pthread_mutex_unlock(&c->report_lock);
+
+  // Keep each diagnostic in one piece when the lexer thread is reporting too
+  flockfile(c->err);
+  if (found == 0)
+    fprintf(c->err, "%s:%u:%u: %s: ", c->path, loc.line, loc.column, level);
+  else
+    fprintf(c->err, "%s: byte %u: %s: ", c->path, offset, level);
+  vfprintf(c->err, fmt, args);
+  fputc('\n', c->err);
+  funlockfile(c->err);
+}
+
+// Report an error at an offset into the source
+void error_at(compiler *c, unsigned int offset, const char *fmt, ...) {
+  if (atomic_fetch_add(&c->errors, 1) > 0 && c->options.syntax_only)
+    return;
+  va_list args;
+  va_start(args, fmt);
+  report(c, offset, "ERROR", fmt, args);
+  va_end(args);
+}
+
+// Report something wrong at an offset into the source that doesn't stop compilation
+void warning_at(compiler *c, unsigned int offset, const char *fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  report(c, offset, "WARNING", fmt, args);
+  va_end(args);
+}
@@ -0,0 +1,83 @@
+#ifndef COMPILER_H
+#define COMPILER_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "arena.h"
+#include "ast.h"
+#include "intern.h"
+#include "lines.h"
+#include "source.h"
+#include "table_stack.h"
+#include "token.h"
+#include "trace.h"
+#include "type.h"
+
+// How to go about compiling
+typedef struct CompilerOptions {
+    // Scan on a thread of its own so scanning overlaps with parsing
+    bool lex_thread;
+    // Only check that the source parses. No tree or symbols get made
+    bool syntax_only;
+    // Report how the symbol table did once names are resolved
+    bool stats;
+    // Print every token once parsing is done, walking the ones kept along the way
+    bool dump_tokens;
+} compiler_options;
+
+// Everything it takes to compile one source. The parser and scanner keep nothing
+// anywhere else, so any number of these can be compiling at once on different threads
+typedef struct Compiler {
+    // Name of the source for diagnostics
+    const char *path;
+    source input;
+    compiler_options options;
+    // Where the tree and the diagnostics get written
+    FILE *out;
+    FILE *err;
+    // Where the lines of the source start
+    line_table *lines;
+    // Every identifier the scanner sees is interned here
+    intern_pool *identifiers;
+    // Every symbol comes out of here, and gets an index in symbols
+    arena *symbol_arena;
+    symbol_array *symbols;
+    // Names in scope while the semantic pass runs. Gone once every name is resolved
+    table_stack *symbol_table;
+    // Every type named or worked out in the source, each made once
+    type_pool *types;
+    // The tree for the whole compilation unit
+    ast *syntax_tree;
+    // Root of the tree once the whole program has parsed
+    ast_ref program;
+    // State of whichever scanner is built in
+    void *scanner;
+    // Every token of the source, scanned ahead of the parser
+    token_stream *tokens;
+    // Tokens traced by the scanner, NULL when tracing is off
+    trace *trace;
+    // Number of errors reported. The lexer thread reports them too
+    atomic_uint errors;
+    // Keeps the lexer thread and the parser from both building the line table
+    pthread_mutex_t report_lock;
+} compiler;
+
+// Create a compiler for the source at path, or stdin if path is NULL, that writes to out and err.
+// Returns NULL if the source couldn't be opened
+compiler *compiler_new(const char *path, const compiler_options *options, FILE *out, FILE *err);
+
+// Delete a compiler and everything it made
+void compiler_del(compiler *c);
+
+// Parse and check the source. Returns -1 if there was anything wrong with it
+int compiler_run(compiler *c);
+
+// Report an error at an offset into the source. Checking syntax only stops at the first one
+void error_at(compiler *c, unsigned int offset, const char *fmt, ...);
+
+// Report something wrong at an offset into the source that doesn't stop compilation
+void warning_at(compiler *c, unsigned int offset, const char *fmt, ...);
+
+#endif
@@ -0,0 +1,128 @@
+// open_memstream is outside of plain C11
+#define _DEFAULT_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "driver.h"
+
+// Compile a single source, or stdin if path is NULL, writing to out and err
+int driver_compile(const char *path, const compiler_options *options, FILE *out, FILE *err) {
+  compiler *c = compiler_new(path, options, out, err);
+  if (c == NULL) {
+    fprintf(err, "Couldn't open %s\n", path);
+    return -1;
+  }
+  int status = compiler_run(c);
+  compiler_del(c);
+  return status;
+}
+
+// Keep taking jobs until there aren't any left
+static void *driver_work(void *arg) {
+  driver *d = arg;
+  unsigned int i;
+  while ((i = atomic_fetch_add(&d->next, 1)) < d->len) {
+    driver_job *job = &d->jobs[i];
+    FILE *out = open_memstream(&job->out, &job->out_len);
+    FILE *err = open_memstream(&job->err, &job->err_len);
+    job->status = driver_compile(job->path, d->options, out, err);
+    // Closing them is what fills in the buffers
+    fclose(out);
+    fclose(err);
+
+    pthread_mutex_lock(&d->lock);
+    job->done = true;
+    pthread_cond_broadcast(&d->finished);
+    pthread_mutex_unlock(&d->lock);
+  }
+  return NULL;
+}
+
+// Compile every source on workers threads
+unsigned int driver_run(const char **paths, unsigned int len, unsigned int workers, const compiler_options *options) {
+  unsigned int failed = 0;
+  if (workers > len)
+    workers = len;
+  // Without a pool to wait on, everything can be written as it happens
+  if (workers <= 1) {
+    for (unsigned int i = 0; i < len; ++i)
+      failed += driver_compile(paths[i], options, stdout, stderr) == -1;
+    return failed;
+  }
+
+  driver d;
+  d.jobs = calloc(len, sizeof(driver_job));
+  d.len = len;
+  d.options = options;
+  atomic_init(&d.next, 0);
+  pthread_mutex_init(&d.lock, NULL);
+  pthread_cond_init(&d.finished, NULL);
+  for (unsigned int i = 0; i < len; ++i)
+    d.jobs[i].path = paths[i];
+
+  pthread_t *threads = malloc(sizeof(pthread_t) * workers);
+  unsigned int started = 0;
+  while (started < workers && pthread_create(&threads[started], NULL, driver_work, &d) == 0)
+    ++started;
+  // Make do on this thread if none of them could be started
+  if (started == 0)
+    driver_work(&d);
+
+  // Hand out what each job printed in order, waiting on the ones that aren't done yet
+  for (unsigned int i = 0; i < len; ++i) {
+    driver_job *job = &d.jobs[i];
+    pthread_mutex_lock(&d.lock);
+    while (!job->done)
+      pthread_cond_wait(&d.finished, &d.lock);
+    pthread_mutex_unlock(&d.lock);
+
+    fwrite(job->out, 1, job->out_len, stdout);
+    fwrite(job->err, 1, job->err_len, stderr);
+    free(job->out);
+    free(job->err);
+    failed += job->status == -1;
+  }
+
+  for (unsigned int i = 0; i < started; ++i)
+    pthread_join(threads[i], NULL);
+  free(threads);
+  pthread_mutex_destroy(&d.lock);
+  pthread_cond_destroy(&d.finished);
+  free(d.jobs);
+  return failed;
+}
+
+// Add a source to compile
+void driver_add(vec *paths, const char *path) {
+  vec_push_back(paths, strdup(path));
+}
+
+// Add the paths listed in a response file
+int driver_read_response(const char *path, vec *paths) {
+  FILE *f = fopen(path, "r");
+  if (f == NULL)
+    return -1;
+
+  char *word = NULL;
+  size_t len = 0;
+  size_t cap = 0;
+  int ch;
+  do {
+    ch = fgetc(f);
+    if (ch != EOF && !isspace(ch)) {
+      if (len + 1 >= cap) {
+        cap = cap == 0 ? 64 : cap * 2;
+        word = realloc(word, cap);
+      }
+      word[len++] = (char) ch;
+    } else if (len > 0) {
+      word[len] = '\0';
+      driver_add(paths, word);
+      len = 0;
+    }
+  } while (ch != EOF);
+
+  free(word);
+  fclose(f);
+  return 0;
+}
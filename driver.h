@@ -0,0 +1,49 @@
+#ifndef DRIVER_H
+#define DRIVER_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "vec.h"
+#include "compiler.h"
+
+// One source given to the driver and what came of compiling it
+typedef struct DriverJob {
+    const char *path;
+    // Everything compiling it printed, held back so it comes out in the order the sources were given
+    char *out;
+    size_t out_len;
+    char *err;
+    size_t err_len;
+    // -1 if it didn't compile
+    int status;
+    bool done;
+} driver_job;
+
+// Sources being compiled by a pool of workers
+typedef struct Driver {
+    driver_job *jobs;
+    unsigned int len;
+    // Next job for a worker to pick up
+    atomic_uint next;
+    const compiler_options *options;
+    // Signalled whenever a job is done
+    pthread_mutex_t lock;
+    pthread_cond_t finished;
+} driver;
+
+// Compile a single source, or stdin if path is NULL, writing to out and err. Returns -1 if it didn't compile
+int driver_compile(const char *path, const compiler_options *options, FILE *out, FILE *err);
+
+// Compile every source on workers threads. What each one prints comes out in the same order
+// as paths no matter which finishes first. Returns the number that didn't compile
+unsigned int driver_run(const char **paths, unsigned int len, unsigned int workers, const compiler_options *options);
+
+// Add a source to compile. paths owns its own copy of the path
+void driver_add(vec *paths, const char *path);
+
+// Add the paths listed in a response file, separated by whitespace. Returns -1 if it couldn't be read
+int driver_read_response(const char *path, vec *paths);
+
+#endif
@@ -0,0 +1,124 @@
+/*
+ * NOTE: hash_wy is the final version 4 of wyhash by Wang Yi, which is in the
+ * public domain (https://github.com/wangyi-fudan/wyhash), trimmed down to the
+ * 64 bit little endian case. hash_fx follows rustc's FxHasher
+ */
+#include <stdint.h>
+#include <string.h>
+#include "hash.h"
+
+// Default secret for wyhash
+static const uint64_t wy_secret[4] = {
+    0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull
+};
+
+// Unaligned little endian reads
+static inline uint64_t read8(const uint8_t *p) {
+  uint64_t v;
+  memcpy(&v, p, 8);
+  return v;
+}
+static inline uint64_t read4(const uint8_t *p) {
+  uint32_t v;
+  memcpy(&v, p, 4);
+  return v;
+}
+// Read 1 to 3 bytes
+static inline uint64_t read3(const uint8_t *p, size_t n) {
+  return ((uint64_t) p[0] << 16) | ((uint64_t) p[n >> 1] << 8) | p[n - 1];
+}
+
+// 64x64 -> 128 bit multiply, low half in a and high half in b
+static inline void wy_mum(uint64_t *a, uint64_t *b) {
+  __uint128_t r = (__uint128_t) *a * *b;
+  *a = (uint64_t) r;
+  *b = (uint64_t) (r >> 64);
+}
+
+// Multiply and fold the halves back together
+static inline uint64_t wy_mix(uint64_t a, uint64_t b) {
+  wy_mum(&a, &b);
+  return a ^ b;
+}
+
+// PJW / ELF hash
+unsigned long hashpjw(const void *k, size_t n, unsigned long seed) {
+  unsigned long high = 0;
+  unsigned long  h = seed;
+
+  for (size_t i = 0; i < n; ++i) {
+    // Casting to a char pointer, so I can only index a single byte at once
+    h = (h << 4) + ((const unsigned char *) k)[i];
+    if ((high = h & 0xF0000000) > 0)
+      h ^= high >> 24;
+    h &= ~high;
+  }
+  return h;
+}
+
+// FxHash
+unsigned long hash_fx(const void *k, size_t n, unsigned long seed) {
+  const uint64_t fx_k = 0x517cc1b727220a95ull;
+  const uint8_t *p = k;
+  uint64_t h = seed;
+
+  // Fold a word in at a time, then whatever is left over
+  for (; n >= 8; n -= 8, p += 8)
+    h = (((h << 5) | (h >> 59)) ^ read8(p)) * fx_k;
+  if (n >= 4) {
+    h = (((h << 5) | (h >> 59)) ^ read4(p)) * fx_k;
+    n -= 4;
+    p += 4;
+  }
+  for (; n > 0; --n, ++p)
+    h = (((h << 5) | (h >> 59)) ^ *p) * fx_k;
+  // The multiplies only carry entropy upwards, so bring the high bits down
+  return h ^ (h >> 32);
+}
+
+// wyhash
+unsigned long hash_wy(const void *k, size_t n, unsigned long seed) {
+  const uint8_t *p = k;
+  uint64_t s = seed ^ wy_mix(seed ^ wy_secret[0], wy_secret[1]);
+  uint64_t a, b;
+
+  if (n <= 16) {
+    if (n >= 4) {
+      // Two overlapping pairs of 4 byte reads cover anything from 4 to 16 bytes
+      a = (read4(p) << 32) | read4(p + ((n >> 3) << 2));
+      b = (read4(p + n - 4) << 32) | read4(p + n - 4 - ((n >> 3) << 2));
+    } else if (n > 0) {
+      a = read3(p, n);
+      b = 0;
+    } else {
+      a = b = 0;
+    }
+  } else {
+    size_t i = n;
+    // Three independent lanes for long keys
+    if (i > 48) {
+      uint64_t s1 = s, s2 = s;
+      do {
+        s = wy_mix(read8(p) ^ wy_secret[1], read8(p + 8) ^ s);
+        s1 = wy_mix(read8(p + 16) ^ wy_secret[2], read8(p + 24) ^ s1);
+        s2 = wy_mix(read8(p + 32) ^ wy_secret[3], read8(p + 40) ^ s2);
+        p += 48;
+        i -= 48;
+      } while (i > 48);
+      s ^= s1 ^ s2;
+    }
+    while (i > 16) {
+      s = wy_mix(read8(p) ^ wy_secret[1], read8(p + 8) ^ s);
+      i -= 16;
+      p += 16;
+    }
+    // The last 16 bytes, overlapping what came before if need be
+    a = read8(p + i - 16);
+    b = read8(p + i - 8);
+  }
+
+  a ^= wy_secret[1];
+  b ^= s;
+  wy_mum(&a, &b);
+  return wy_mix(a ^ wy_secret[0] ^ n, b ^ wy_secret[1]);
+}
@@ -0,0 +1,24 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <stddef.h>
+
+/*
+ * Family of hash functions for hashmaps and the intern pool. Each one takes
+ * the key, its length in bytes and a seed, and they can be swapped for each
+ * other wherever a hash is asked for. Maps that might see keys picked by
+ * someone hostile should use hash_wy with a seed of their own
+ */
+
+// Classic PJW / ELF hash. One byte at a time and only 28 bits wide
+unsigned long hashpjw(const void *k, size_t n, unsigned long seed);
+
+// FxHash style. Folds the key in a word at a time with a rotate and a multiply.
+// Cheap, but it mixes a lot less than hash_wy does and is easy to collide on purpose
+unsigned long hash_fx(const void *k, size_t n, unsigned long seed);
+
+// wyhash. Reads a word at a time and mixes with 64x64->128 bit multiplies.
+// Full 64 bit output with good avalanche, and as fast as hash_fx past a few bytes
+unsigned long hash_wy(const void *k, size_t n, unsigned long seed);
+
+#endif
@@ -1,34 +1,27 @@
 #include "stdio.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 #include "avl.h"
 #include "vec.h"
 #include "hashmap.h"
 
-//Default hashing function
-unsigned long hashpjw(const void *k, size_t n) {
-  unsigned long high = 0;
-  unsigned long  h = 0;
-
-  for (size_t i = 0; i < n; ++i) {
-    // Casting to a char pointer, so I can only index a single byte at once
-    h = (unsigned long) ((h << 4) + ((char *) *((char *) k) + i));
-    if ((high = h & 0xF0000000) > 0)
-      h ^= high >> 24;
-    h &= ~high;
-  }
-  return h;
-}
-
 // Comparison function for hashmap entries
 // Needed in key searching / sorting in the tree
 int map_simple_entry_cmp(const void *a, const void *b) {
+  // Different hashes mean different keys, and they still give a total order
+  unsigned long a_hash = ((hashmap_entry *) a)->hash;
+  unsigned long b_hash = ((hashmap_entry *) b)->hash;
+  if (a_hash != b_hash)
+    return a_hash > b_hash ? 1 : -1;
+
   // Convert to a byte array and compare byte by byte
   char *ak = (char *) ((hashmap_entry *) a)->key;
   char *bk = (char *) ((hashmap_entry *) b)->key;
-  size_t a_size = (size_t) ((hashmap_entry *) a)->key_size;
-  size_t b_size = (size_t) ((hashmap_entry *) b)->key_size;
-  size_t a_len = (size_t) ((hashmap_entry *) a)->key_len;
-  size_t b_len = (size_t) ((hashmap_entry *) b)->key_len;
-  for (size_t i = 0; i < min(a_size*a_len, b_size*b_len); ++i) {
+  size_t a_bytes = (size_t) ((hashmap_entry *) a)->key_size * ((hashmap_entry *) a)->key_len;
+  size_t b_bytes = (size_t) ((hashmap_entry *) b)->key_size * ((hashmap_entry *) b)->key_len;
+  size_t bytes = a_bytes < b_bytes ? a_bytes : b_bytes;
+  for (size_t i = 0; i < bytes; ++i) {
     if (ak[i] > bk[i])
       return 1;
     else if (ak[i] < bk[i])
@@ -36,94 +29,413 @@ int map_simple_entry_cmp(const void *a, const void *b) {
   }
 
   // Make sure one is not longer than the other
-  if (a_size > b_size)
+  if (a_bytes > b_bytes)
     return 1;
-  else if (a_size < b_size)
+  else if (a_bytes < b_bytes)
     return -1;
 
   // They truly are the same, byte by byte and by length
   return 0;
 }
 
-hashmap *map_with_hash(
+// Comparison function for hashmap entries whose keys are unique pointers
+// (like interned strings). Only the key pointers themselves are compared
+int map_identity_entry_cmp(const void *a, const void *b) {
+  return simple_cmp(((hashmap_entry *) a)->key, ((hashmap_entry *) b)->key);
+}
+
+/* MAP_FLAT helpers */
+// Spread the bits of a hash around. Simple hashes like hashpjw keep most of
+// their entropy in the low bits, which would cluster the slots and tags
+static inline unsigned long map_flat_mix(unsigned long h) {
+  h ^= h >> 31;
+  h *= 0x9E3779B97F4A7C15UL;
+  return h ^ (h >> 29);
+}
+
+// Mixed hash of an entry already in the map
+static inline unsigned long map_flat_hash(const hashmap_entry *e) {
+  return map_flat_mix(e->hash);
+}
+
+// Slot the probe sequence of a mixed hash starts at
+static inline unsigned int map_flat_home(const hashmap *m, unsigned long h) {
+  return h & (m->bucket_size - 1);
+}
+
+// Control byte stored for a full slot, from the top bits of a mixed hash
+static inline signed char map_flat_tag(unsigned long h) {
+  return (signed char) (h >> 57);
+}
+
+// Set the control byte of a slot, keeping the mirrored first group in sync
+static inline void map_flat_set_ctrl(hashmap *m, unsigned int i, signed char c) {
+  m->ctrl[i] = c;
+  if (i < MAP_GROUP_SIZE)
+    m->ctrl[m->bucket_size + i] = c;
+}
+
+// Bit masks of the slots in the group starting at pos whose control byte
+// matches the tag, and of the slots that are empty
+static inline void map_flat_match(
+    const hashmap *m,
+    unsigned int pos,
+    signed char tag,
+    unsigned int *match,
+    unsigned int *empty
+) {
+#ifdef __SSE2__
+  __m128i group = _mm_loadu_si128((const __m128i *) (m->ctrl + pos));
+  *match = _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(tag)));
+  // Only the empty control byte has its high bit set
+  *empty = _mm_movemask_epi8(group);
+#else
+  *match = *empty = 0;
+  for (unsigned int i = 0; i < MAP_GROUP_SIZE; ++i) {
+    *match |= (unsigned int) (m->ctrl[pos + i] == tag) << i;
+    *empty |= (unsigned int) (m->ctrl[pos + i] == MAP_CTRL_EMPTY) << i;
+  }
+#endif
+}
+
+// Find the slot holding an entry. Returns -1 if it is not in the map
+static long map_flat_find(const hashmap *m, const hashmap_entry *e, unsigned long h) {
+  unsigned int mask = m->bucket_size - 1;
+  unsigned int pos = map_flat_home(m, h);
+  signed char tag = map_flat_tag(h);
+  for (;;) {
+    unsigned int match, empty;
+    map_flat_match(m, pos, tag, &match, &empty);
+    // Linear probing never leaves a gap, so nothing past the first empty slot counts
+    if (empty != 0)
+      match &= (empty & -empty) - 1;
+    while (match != 0) {
+      unsigned int i = (pos + __builtin_ctz(match)) & mask;
+      // Only call out to the comparison when the full hashes agree
+      if (m->slots[i]->hash == e->hash && m->cmp(e, m->slots[i]) == 0)
+        return i;
+      match &= match - 1;
+    }
+    if (empty != 0)
+      return -1;
+    pos = (pos + MAP_GROUP_SIZE) & mask;
+  }
+}
+
+// Put an entry that is known not to be in the map into the first free slot
+static void map_flat_place(hashmap *m, hashmap_entry *e, unsigned long h) {
+  unsigned int mask = m->bucket_size - 1;
+  unsigned int pos = map_flat_home(m, h);
+  for (;;) {
+    unsigned int match, empty;
+    map_flat_match(m, pos, MAP_CTRL_EMPTY, &match, &empty);
+    if (empty != 0) {
+      unsigned int i = (pos + __builtin_ctz(empty)) & mask;
+      map_flat_set_ctrl(m, i, map_flat_tag(h));
+      m->slots[i] = e;
+      return;
+    }
+    pos = (pos + MAP_GROUP_SIZE) & mask;
+  }
+}
+
+// Allocate empty slots for a MAP_FLAT map
+static void map_flat_alloc(hashmap *m, unsigned int size) {
+  m->bucket_size = size;
+  m->ctrl = malloc(size + MAP_GROUP_SIZE);
+  memset(m->ctrl, MAP_CTRL_EMPTY, size + MAP_GROUP_SIZE);
+  m->slots = calloc(size, sizeof(hashmap_entry *));
+}
+
+// Move every entry over to a new number of slots
+static void map_flat_resize(hashmap *m, unsigned int new_size) {
+  unsigned int size = m->bucket_size;
+  signed char *ctrl = m->ctrl;
+  hashmap_entry **slots = m->slots;
+
+  map_flat_alloc(m, new_size);
+  for (unsigned int i = 0; i < size; ++i) {
+    if (ctrl[i] != MAP_CTRL_EMPTY)
+      map_flat_place(m, slots[i], map_flat_hash(slots[i]));
+  }
+  free(ctrl);
+  free(slots);
+}
+
+// Empty a slot, then shift the rest of its probe run back so lookups can keep
+// stopping at the first empty slot. Deletion never leaves a tombstone behind
+static void map_flat_erase(hashmap *m, unsigned int i) {
+  unsigned int mask = m->bucket_size - 1;
+  unsigned int j = i;
+  for (;;) {
+    j = (j + 1) & mask;
+    if (m->ctrl[j] == MAP_CTRL_EMPTY)
+      break;
+    hashmap_entry *e = m->slots[j];
+    unsigned int home = map_flat_home(m, map_flat_hash(e));
+    // The entry has to stay put if its home lies cyclically in (i, j]
+    if (((j - home) & mask) < ((j - i) & mask))
+      continue;
+    map_flat_set_ctrl(m, i, m->ctrl[j]);
+    m->slots[i] = e;
+    i = j;
+  }
+  map_flat_set_ctrl(m, i, MAP_CTRL_EMPTY);
+  m->slots[i] = NULL;
+}
+
+/* MAP_AVL helpers */
+// Number of old buckets moved over on each operation while rehashing
+#define MAP_REHASH_STEP 4
+// Smallest number of buckets a MAP_AVL map shrinks down to
+#define MAP_MIN_BUCKETS 7
+
+// Get the bucket a hash falls in, creating its tree the first time it is used
+static avl_tree *map_avl_bucket(hashmap *m, unsigned long h) {
+  avl_tree **b = m->buckets + h % m->bucket_size;
+  if (*b == NULL)
+    *b = avl_tree_new(m->cmp, m->copy, m->del);
+  return *b;
+}
+
+// Get the old bucket a hash falls in while rehashing
+// Returns NULL if there is no such bucket or it has already been moved over
+static avl_tree *map_avl_old_bucket(const hashmap *m, unsigned long h) {
+  if (m->old_buckets == NULL)
+    return NULL;
+  unsigned int i = h % m->old_bucket_size;
+  return i < m->rehash_pos ? NULL : m->old_buckets[i];
+}
+
+// Move the entries under an old node into the current buckets. The nodes
+// get freed along the way, but the entries themselves are reused
+static void map_avl_move_nodes(hashmap *m, avl_tree_node *n) {
+  if (n == NULL)
+    return;
+  map_avl_move_nodes(m, n->left);
+  map_avl_move_nodes(m, n->right);
+  hashmap_entry *e = n->e;
+  avl_tree_insert(map_avl_bucket(m, e->hash), e);
+  free(n);
+}
+
+// Move up to steps more old buckets over to the current ones
+static void map_avl_rehash_step(hashmap *m, unsigned int steps) {
+  if (m->old_buckets == NULL)
+    return;
+  while (steps-- > 0 && m->rehash_pos < m->old_bucket_size) {
+    avl_tree *t = m->old_buckets[m->rehash_pos++];
+    if (t != NULL) {
+      map_avl_move_nodes(m, t->root);
+      free(t);
+    }
+  }
+
+  // Done with the old buckets
+  if (m->rehash_pos == m->old_bucket_size) {
+    free(m->old_buckets);
+    m->old_buckets = NULL;
+    m->old_bucket_size = 0;
+    m->rehash_pos = 0;
+  }
+}
+
+// Start moving every entry over to a new number of buckets. The move itself
+// happens a few buckets at a time as the map gets used
+static void map_avl_resize(hashmap *m, unsigned int size) {
+  // Only one rehash at a time, so finish off the last one
+  map_avl_rehash_step(m, m->old_bucket_size);
+  m->old_buckets = m->buckets;
+  m->old_bucket_size = m->bucket_size;
+  m->rehash_pos = 0;
+  m->bucket_size = size;
+  // Trees are only made once a bucket gets used
+  m->buckets = calloc(size + 1, sizeof(avl_tree *));
+}
+
+// Grow or shrink the map once it's out of its load factor
+static void map_avl_check_load(hashmap *m) {
+  if (m->old_buckets != NULL)
+    return;
+  if (m->len > m->load_factor * m->bucket_size) {
+    map_avl_resize(m, m->bucket_size * 2 + 1);
+  } else if (m->bucket_size > MAP_MIN_BUCKETS && m->len < m->load_factor * m->bucket_size / 4) {
+    unsigned int size = m->bucket_size / 2;
+    map_avl_resize(m, size < MAP_MIN_BUCKETS ? MAP_MIN_BUCKETS : size);
+  }
+}
+
+hashmap *map_with(
+    map_backend backend,
     size_t size,
-    unsigned long (*hash) (const void* k, size_t n),
+    unsigned long (*hash) (const void* k, size_t n, unsigned long seed),
+    int (*cmp) (const void *a, const void *b),
     void *(*copy) (const void *e),
     void (*del) (void *e)
 ) {
   hashmap *m = (hashmap *) malloc(sizeof(hashmap));
+  m->backend = backend;
   m->hash = hash;
+  m->cmp = cmp;
   m->copy = copy;
   m->del = del;
-  m->bucket_size = size;
   m->len = 0;
-  m->buckets = malloc(sizeof(avl_tree)*(size+1));
-  // Initialize all of the trees
-  for (size_t i = 0; i < size; ++i) {
-    m->buckets[i] = avl_tree_new(map_simple_entry_cmp, copy, del);
+  m->buckets = NULL;
+  m->ctrl = NULL;
+  m->slots = NULL;
+  m->old_buckets = NULL;
+  m->old_bucket_size = 0;
+  m->rehash_pos = 0;
+  m->load_factor = 1;
+  m->seed = 0;
+
+  if (backend == MAP_FLAT) {
+    // Round up to a power of 2 that can hold at least a whole group
+    unsigned int slots = MAP_GROUP_SIZE;
+    while (slots < size)
+      slots <<= 1;
+    map_flat_alloc(m, slots);
+    return m;
   }
-  // Set last bucket to NULL just in case
-  m->buckets[size] = NULL;
+
+  m->bucket_size = size;
+  // Trees are only made once a bucket gets used. The extra NULL on the
+  // end is just in case
+  m->buckets = calloc(size + 1, sizeof(avl_tree *));
   return m;
 }
 
+// Delete a hashmap
+void map_del(hashmap *m) {
+  if (m->backend == MAP_FLAT) {
+    // Free every entry left in the slots
+    for (unsigned int i = 0; i < m->bucket_size; ++i) {
+      if (m->ctrl[i] != MAP_CTRL_EMPTY)
+        m->del(m->slots[i]);
+    }
+    free(m->ctrl);
+    free(m->slots);
+  } else {
+    // Free all of the trees
+    for (size_t i = 0; i < m->bucket_size; ++i) {
+      if (m->buckets[i] != NULL)
+        avl_tree_del(m->buckets[i]);
+    }
+    // Including any that never got rehashed
+    for (size_t i = m->rehash_pos; i < m->old_bucket_size; ++i) {
+      if (m->old_buckets[i] != NULL)
+        avl_tree_del(m->old_buckets[i]);
+    }
+    //Free the buckets
+    free(m->buckets);
+    free(m->old_buckets);
+  }
+  // Free the map itself
+  free(m);
+}
+
+// Make room for at least n entries up front
+void map_reserve(hashmap *m, unsigned int n) {
+  if (m->backend == MAP_FLAT) {
+    unsigned int size = m->bucket_size;
+    while (n * 8 > size * 7)
+      size <<= 1;
+    if (size > m->bucket_size)
+      map_flat_resize(m, size);
+    return;
+  }
+
+  unsigned int size = n / m->load_factor + 1;
+  if (size <= m->bucket_size)
+    return;
+  // The caller asked for it, so do the whole rehash right now
+  map_avl_resize(m, size);
+  map_avl_rehash_step(m, m->old_bucket_size);
+}
+
 // Insert into the map
 // The key must be a pointer to the thing you actually want to use
 void map_insert(hashmap *m, void **k, unsigned int key_size, unsigned int key_len, void *v) {
-  unsigned int index = hashpjw(k, key_size*key_len) % m->bucket_size;
-  avl_tree *bucket = m->buckets[index];
-  // Get length of bucket
-  unsigned int len = bucket->len;
-
-  // Wipe high bytes in key when size is less than 8
-  // This is fine if 8 - key_size comes out to be 0
-  ptrdiff_t key = k;
-  if (key_len == 1) {
-    ptrdiff_t key = *k;
-    long shift = 8 - key_size;
-    if (shift > 0)
-      key = (key << shift*8) >> shift*8;
-  }
+  unsigned long h = m->hash(k, key_size*key_len, m->seed);
 
   // Initialize the entry
   hashmap_entry *e = (void *) malloc(sizeof(hashmap_entry));
-  e->key = key;
+  e->key = k;
   e->key_size = key_size;
   e->key_len = key_len;
+  e->hash = h;
   e->value = v;
 
+  if (m->backend == MAP_FLAT) {
+    h = map_flat_mix(h);
+    long i = map_flat_find(m, e, h);
+    // We cannot have duplicates, so update it
+    if (i != -1) {
+      m->del(m->slots[i]);
+      m->slots[i] = e;
+      return;
+    }
+    // Keep at least 1/8th of the slots empty so probes always terminate quickly
+    if ((m->len + 1) * 8 > m->bucket_size * 7)
+      map_flat_resize(m, m->bucket_size * 2);
+    map_flat_place(m, e, h);
+    ++m->len;
+    return;
+  }
+
+  map_avl_rehash_step(m, MAP_REHASH_STEP);
+
+  // While rehashing the key could still be sitting in its old bucket.
+  // Dropping it there is the same as replacing a duplicate
+  avl_tree *old = map_avl_old_bucket(m, h);
+  if (old != NULL) {
+    unsigned int len = old->len;
+    avl_tree_remove(old, e);
+    m->len -= len - old->len;
+  }
+
+  avl_tree *bucket = map_avl_bucket(m, h);
+  // Get length of bucket
+  unsigned int len = bucket->len;
+
   // Insert into the bucket
   avl_tree_insert(bucket, e);
 
   // Check to see if the bucket size changed
   if (len < bucket->len)
     ++m->len;
+  map_avl_check_load(m);
 }
 
 // Get key from the map. If value_size is -1 then the value was not found
 int map_get(hashmap *m, void **k, unsigned int key_size, unsigned int key_len, void **v) {
-  unsigned int index = hashpjw(k, key_size*key_len) % m->bucket_size;
-  avl_tree *bucket = m->buckets[index];
-
-  // Wipe high bytes in key when size is less than 8
-  // This is fine if 8 - key_size comes out to be 0
-  ptrdiff_t key = k;
-  if (key_len == 1) {
-    ptrdiff_t key = *k;
-    long shift = 8 - key_size;
-    if (shift > 0)
-      key = (key << shift*8) >> shift*8;
-  }
+  unsigned long h = m->hash(k, key_size*key_len, m->seed);
 
   // Make entry to search with
   hashmap_entry entry = {
-      .key = key,
+      .key = k,
       .key_size = key_size,
       .key_len = key_len,
+      .hash = h,
   };
 
-  // Get the result from our tree
-  search_result r = avl_tree_get(bucket, &entry);
+  if (m->backend == MAP_FLAT) {
+    long i = map_flat_find(m, &entry, map_flat_mix(h));
+    if (i == -1)
+      return -1;
+    *v = m->slots[i]->value;
+    return 0;
+  }
+
+  map_avl_rehash_step(m, MAP_REHASH_STEP);
+
+  // Get the result from our tree, or the old one if it hasn't moved yet
+  search_result r = { .found = false };
+  avl_tree *bucket = m->buckets[h % m->bucket_size];
+  if (bucket != NULL)
+    r = avl_tree_get(bucket, &entry);
+  if (!r.found && (bucket = map_avl_old_bucket(m, h)) != NULL)
+    r = avl_tree_get(bucket, &entry);
 
   // Set the value if we found it
   if (r.found) {
@@ -135,21 +447,98 @@ int map_get(hashmap *m, void **k, unsigned int key_size, unsigned int key_len, v
 
 // Remove key from the map
 void map_remove(hashmap *m, void **k, unsigned int key_size, unsigned int key_len) {
-  unsigned int index = hashpjw(k, key_size) % m->bucket_size;
-  avl_tree *bucket = m->buckets[index];
-  // Get bucket length
-  unsigned int len = bucket->len;
+  unsigned long h = m->hash(k, key_size*key_len, m->seed);
 
   // Make entry to search with
   hashmap_entry entry = {
-      .key = *k,
+      .key = k,
       .key_size = key_size,
+      .key_len = key_len,
+      .hash = h,
   };
 
-  avl_tree_remove(bucket, &entry);
-  // Check to see if bucket length changed
-  if (len > bucket->len)
-    --m->len;
+  if (m->backend == MAP_FLAT) {
+    long i = map_flat_find(m, &entry, map_flat_mix(h));
+    if (i != -1) {
+      m->del(m->slots[i]);
+      map_flat_erase(m, i);
+      --m->len;
+    }
+    return;
+  }
+
+  map_avl_rehash_step(m, MAP_REHASH_STEP);
+
+  // The key is either in its current bucket or still in its old one
+  avl_tree *buckets[2] = { m->buckets[h % m->bucket_size], map_avl_old_bucket(m, h) };
+  for (int i = 0; i < 2; ++i) {
+    if (buckets[i] == NULL)
+      continue;
+    // Get bucket length
+    unsigned int len = buckets[i]->len;
+
+    avl_tree_remove(buckets[i], &entry);
+    // Check to see if bucket length changed
+    m->len -= len - buckets[i]->len;
+  }
+  map_avl_check_load(m);
+}
+
+// Start a cursor at the first entry of the map
+void map_iter_init(map_iter *it, const hashmap *m) {
+  it->m = m;
+  it->i = 0;
+  it->old = false;
+  // Nothing to walk until the first non-empty bucket turns up
+  it->tree.depth = 0;
+  it->tree.forward = true;
+}
+
+// Move to the next entry of the map
+bool map_iter_next(map_iter *it, hashmap_entry **e) {
+  const hashmap *m = it->m;
+  if (m->backend == MAP_FLAT) {
+    while (it->i < m->bucket_size) {
+      unsigned int i = it->i++;
+      if (m->ctrl[i] != MAP_CTRL_EMPTY) {
+        *e = m->slots[i];
+        return true;
+      }
+    }
+    return false;
+  }
+
+  for (;;) {
+    // Finish off the tree we're in the middle of
+    if (avl_tree_iter_next(&it->tree, (void **) e))
+      return true;
+
+    // Then find the next tree, and once the buckets run out,
+    // move over to anything that hasn't been rehashed yet
+    avl_tree **buckets = it->old ? m->old_buckets : m->buckets;
+    unsigned int size = it->old ? m->old_bucket_size : m->bucket_size;
+    if (it->i >= size) {
+      if (it->old || m->old_buckets == NULL)
+        return false;
+      it->old = true;
+      it->i = m->rehash_pos;
+      continue;
+    }
+    avl_tree *t = buckets[it->i++];
+    if (t != NULL)
+      avl_tree_iter_init(&it->tree, t, true);
+  }
+}
+
+// Get pairs in map
+list *map_pairs(const hashmap *m) {
+  // Don't let the list accidentally free the data
+  list *l = list_new(m->cmp, m->copy, do_not_del);
+  map_iter it;
+  hashmap_entry *e;
+  for (map_iter_init(&it, m); map_iter_next(&it, &e);)
+    list_push_back(l, e);
+  return l;
 }
 
 // Get keys in map
@@ -157,143 +546,151 @@ list *map_keys(const hashmap *m) {
   // Set stack del as delete because we never actually want to call free on these elements
   // They could still be in the map and that would be bad
   list *l = list_new(map_simple_entry_cmp, return_elem, do_not_del);
-  list *pairs = map_pairs(m);
-  for (list_node *n = pairs->head->next; n != pairs->tail; n = n->next)
-    list_push_back(l, ((hashmap_entry *)n->e)->key);
-  list_del(pairs);
+  map_iter it;
+  hashmap_entry *e;
+  for (map_iter_init(&it, m); map_iter_next(&it, &e);)
+    list_push_back(l, e->key);
   return l;
 }
 
 // Get values in map
 list *map_values(const hashmap *m) {
   list *l = list_new(map_simple_entry_cmp, return_elem, do_not_del);
-  list *pairs = map_pairs(m);
-  for (list_node *n = pairs->head->next; n != pairs->tail; n = n->next)
-    list_push_back(l, ((hashmap_entry *)n->e)->value);
+  map_iter it;
+  hashmap_entry *e;
+  for (map_iter_init(&it, m); map_iter_next(&it, &e);)
+    list_push_back(l, e->value);
   return l;
 }
 
 // Copy a map
 hashmap *map_copy(const hashmap *m) {
   hashmap *new_m = malloc(sizeof(hashmap));
+  new_m->backend = m->backend;
   new_m->hash = m->hash;
+  new_m->cmp = m->cmp;
   new_m->copy = m->copy;
   new_m->del = m->del;
   new_m->bucket_size = m->bucket_size;
-  new_m->buckets = malloc(sizeof(avl_tree *) * (m->bucket_size + 1));
+  new_m->len = m->len;
+  new_m->buckets = NULL;
+  new_m->ctrl = NULL;
+  new_m->slots = NULL;
+  new_m->old_buckets = NULL;
+  new_m->old_bucket_size = 0;
+  new_m->rehash_pos = 0;
+  new_m->load_factor = m->load_factor;
+  new_m->seed = m->seed;
+
+  if (m->backend == MAP_FLAT) {
+    // Same layout, so the control bytes carry over as is
+    new_m->ctrl = malloc(m->bucket_size + MAP_GROUP_SIZE);
+    memcpy(new_m->ctrl, m->ctrl, m->bucket_size + MAP_GROUP_SIZE);
+    new_m->slots = calloc(m->bucket_size, sizeof(hashmap_entry *));
+    for (unsigned int i = 0; i < m->bucket_size; ++i) {
+      if (m->ctrl[i] != MAP_CTRL_EMPTY)
+        new_m->slots[i] = m->copy(m->slots[i]);
+    }
+    return new_m;
+  }
+
+  new_m->buckets = calloc(m->bucket_size + 1, sizeof(avl_tree *));
 
   // Copy the trees
   for (unsigned int i = 0; i < m->bucket_size; ++i) {
-    new_m->buckets[i] = avl_tree_copy(m->buckets[i]);
+    if (m->buckets[i] != NULL)
+      new_m->buckets[i] = avl_tree_copy(m->buckets[i]);
   }
 
-  // Set the last one null just in case
-  new_m->buckets[m->bucket_size] = NULL;
-  new_m->len = m->len;
+  // Carry over a rehash in progress as is
+  if (m->old_buckets != NULL) {
+    new_m->old_bucket_size = m->old_bucket_size;
+    new_m->rehash_pos = m->rehash_pos;
+    new_m->old_buckets = calloc(m->old_bucket_size + 1, sizeof(avl_tree *));
+    for (unsigned int i = m->rehash_pos; i < m->old_bucket_size; ++i) {
+      if (m->old_buckets[i] != NULL)
+        new_m->old_buckets[i] = avl_tree_copy(m->old_buckets[i]);
+    }
+  }
 
   return new_m;
 }
 
 // Print a hashmap with given function
 void map_print_with(const hashmap *m, void (p)(hashmap_entry *e)) {
-  list *l = avl_tree_to_list(m->buckets[0]);
-  for (unsigned int i = 1; i < m->bucket_size; ++i)
-    l = list_concat_consume(l, avl_tree_to_list(m->buckets[i]), return_elem);
   if (m->len > 0)
     printf("{\n");
   else
     printf("{");
-  for (list_node *n = l->head->next; n != l->tail; n = n->next) {
-    p(((hashmap_entry*)n->e));
-    if (n->next != l->tail) {
+  map_iter it;
+  hashmap_entry *e;
+  unsigned int printed = 0;
+  for (map_iter_init(&it, m); map_iter_next(&it, &e);) {
+    p(e);
+    if (++printed < m->len) {
       printf(",");
     }
     printf("\n");
   }
   printf("}");
-  // Reset deletion on list so we don't accidentally free the data
-  l->del = do_not_del;
-  list_del(l);
 }
 
 // Print a hashmap (Not exactly the most efficient but only to be used for debugging)
 void map_print(const hashmap *m, char *key_format, char *value_format) {
-  list *l = avl_tree_to_list(m->buckets[0]);
-  for (unsigned int i = 1; i < m->bucket_size; ++i)
-    l = list_concat_consume(l, avl_tree_to_list(m->buckets[i]), return_elem);
+  // 2 comes from ": " 2 comes from ",\n" and 2 come from the indentation
+  unsigned int len = strlen(key_format) + strlen(value_format) + 6;
+  char format[len + 1];
+  char *pos = format;
+  // Make sure the string is null terminating
+  format[len] = '\0';
+
+  // Copy the format into the string bit by bit. This sucks
+  strcpy(pos, "  ");
+  pos += 2;
+  strcpy(pos, key_format);
+  pos += strlen(key_format);
+  strcpy(pos, ": ");
+  pos += 2;
+  strcpy(pos, value_format);
+  pos += strlen(value_format);
+  strcpy(pos, ",\n");
+
   if (m->len > 0)
       printf("{\n");
   else
       printf("{");
-  for (list_node *n = l->head->next; n != l->tail; n = n->next) {
-    // 2 comes from ": " 2 comes from ",\n" and 2 come from the indentation
-    unsigned int len = strlen(key_format) + strlen(value_format) + 6;
-    char format[len + 1];
-    char *pos = format;
-    // Make sure the string is null terminating
-    format[len] = '\0';
-
-    // Copy the format into the string bit by bit. This sucks
-    strcpy(pos, "  ");
-    pos += 2;
-    strcpy(pos, key_format);
-    pos += strlen(key_format);
-    strcpy(pos, ": ");
-    pos += 2;
-    strcpy(pos, value_format);
-    pos += strlen(value_format);
-    strcpy(pos, ",\n");
-
+  map_iter it;
+  hashmap_entry *e;
+  for (map_iter_init(&it, m); map_iter_next(&it, &e);) {
     // Print out the entry
-    printf(format, ((hashmap_entry *)n->e)->key, ((hashmap_entry *)n->e)->value);
+    printf(format, e->key, e->value);
   }
   printf("}");
-  // Reset deletion on list so we don't accidentally free the data
-  l->del = do_not_del;
-  list_del(l);
 }
 
 // Print keys of a hashmap
 void map_keys_print(const hashmap *m, char *format) {
-  list *l = map_pairs(m);
-
-  // Build the new format string
-  char fmt[strlen(format)+3];
-  fmt[strlen(format)+2] = '\0';
-  strcpy(fmt, format);
-  strcpy(fmt+strlen(fmt), ", ");
-
   printf("[");
-  for (list_node *n = l->head->next; n != l->tail; n = n->next) {
-    if (n != l->tail->prev)
-      printf(fmt, ((hashmap_entry *) n->e)->key);
-    else
-      printf(format, ((hashmap_entry *) n->e)->key);
+  map_iter it;
+  hashmap_entry *e;
+  bool first = true;
+  for (map_iter_init(&it, m); map_iter_next(&it, &e); first = false) {
+    if (!first)
+      printf(", ");
+    printf(format, e->key);
   }
   printf("]");
-  // Reset deletion on list so we don't accidentally free the data
-  l->del = do_not_del;
-  list_del(l);
 }
 // Print values of a hashmap
 void map_values_print(const hashmap *m, char *format) {
-  list *l = map_pairs(m);
-
-  // Build the new format string
-  char fmt[strlen(format)+3];
-  fmt[strlen(format)+2] = '\0';
-  strcpy(fmt, format);
-  strcpy(fmt+strlen(fmt), ", ");
-
   printf("[");
-  for (list_node *n = l->head->next; n != l->tail; n = n->next) {
-    if (n != l->tail->prev)
-      printf(fmt, ((hashmap_entry *) n->e)->value);
-    else
-      printf(format, ((hashmap_entry *) n->e)->value);
+  map_iter it;
+  hashmap_entry *e;
+  bool first = true;
+  for (map_iter_init(&it, m); map_iter_next(&it, &e); first = false) {
+    if (!first)
+      printf(", ");
+    printf(format, e->value);
   }
   printf("]");
-  // Reset deletion on list so we don't accidentally free the data
-  l->del = do_not_del;
-  list_del(l);
 }
@@ -2,13 +2,46 @@
 #define HASHMAP_H
 
 #include "simple_functions.h"
+#include "hash.h"
 #include "avl.h"
 #include "list.h"
 
+// How a hashmap lays out its entries
+typedef enum MapBackend {
+    // Separate chaining, one avl_tree per bucket
+    MAP_AVL,
+    // Open addressing over a flat slot array with a control byte per slot
+    // (Swiss table style), probed 16 slots at a time
+    MAP_FLAT,
+} map_backend;
+
+// Size of a control byte group probed at once by MAP_FLAT
+#define MAP_GROUP_SIZE 16
+// Control byte of an empty MAP_FLAT slot. Full slots hold 7 bits of the hash
+#define MAP_CTRL_EMPTY ((signed char) -128)
+
 typedef struct HashMap {
+    map_backend backend;
+    // MAP_AVL buckets
     avl_tree **buckets;
+    // MAP_FLAT control bytes. The first group is mirrored past the end so a
+    // group can be loaded starting at any slot
+    signed char *ctrl;
+    // MAP_FLAT slots
+    struct Entry **slots;
+    // Number of buckets (MAP_AVL) or slots (MAP_FLAT, always a power of 2)
     unsigned int bucket_size;
-    unsigned long (*hash) (const void* k, size_t n);
+    // MAP_AVL buckets still being rehashed into the current ones. Everything
+    // before rehash_pos has already been moved over
+    avl_tree **old_buckets;
+    unsigned int old_bucket_size;
+    unsigned int rehash_pos;
+    // Average entries per MAP_AVL bucket before the map grows
+    float load_factor;
+    // Handed to the hash function along with every key
+    unsigned long seed;
+    unsigned long (*hash) (const void* k, size_t n, unsigned long seed);
+    int (*cmp) (const void *a, const void *b);
     void *(*copy) (const void *e);
     void (*del) (void *e);
     unsigned int len;
@@ -19,21 +52,26 @@ typedef struct Entry {
     void *value;
     unsigned int key_size;
     unsigned int key_len;
+    // Full hash of the key, worked out once when the entry is made
+    unsigned long hash;
 } hashmap_entry;
 
 
 /* Utility functions */
-// Default hashing function
-unsigned long hashpjw(const void *k, size_t n);
 // Comparison function for hashmap entries
-// Needed in key searching / sorting in the tree
+// Needed in key searching / sorting in the tree. Entries are ordered by their
+// cached hash first, so the key bytes only get compared when the hashes match
 int map_simple_entry_cmp(const void *a, const void *b);
+// Comparison function for hashmap entries keyed by unique pointers
+// (like interned strings). Compares the key pointers instead of their bytes
+int map_identity_entry_cmp(const void *a, const void *b);
 // Simple entry copy
 static inline void* map_simple_entry_copy(const void *e) {
   hashmap_entry *new_e = malloc(sizeof(hashmap_entry));
   new_e->key = ((hashmap_entry *) e)->key;
   new_e->key_size = ((hashmap_entry *) e)->key_size;
   new_e->key_len = ((hashmap_entry *) e)->key_len;
+  new_e->hash = ((hashmap_entry *) e)->hash;
   new_e->value = ((hashmap_entry *) e)->value;
   return new_e;
 }
@@ -52,21 +90,43 @@ static inline void map_value_preserve_entry_remove(void *e) {
   free(e);
 }
 
-// Assigning a different hashing function for the hashmap
-hashmap *map_with_hash(
+// Preserve key on removal. Used when the keys are owned by something else
+// like an intern pool
+static inline void map_key_preserve_entry_remove(void *e) {
+  // Free the value
+  free(((hashmap_entry *) e)->value);
+  free(e);
+}
+
+// Assigning a different backend, hashing and key comparison function for the hashmap
+// For MAP_FLAT the size is the number of slots to start with
+hashmap *map_with(
+    map_backend backend,
     size_t size,
-    unsigned long (*hash) (const void* k, size_t n),
+    unsigned long (*hash) (const void* k, size_t n, unsigned long seed),
+    int (*cmp) (const void *a, const void *b),
     void *(*copy) (const void *e),
     void (*del) (void *e)
 );
 
+// Assigning a different backend and hashing function for the hashmap
+static inline hashmap *map_with_hash(
+    map_backend backend,
+    size_t size,
+    unsigned long (*hash) (const void* k, size_t n, unsigned long seed),
+    void *(*copy) (const void *e),
+    void (*del) (void *e)
+) {
+  return map_with(backend, size, hash, map_simple_entry_cmp, copy, del);
+}
+
 // Hashmap with the standard hash function, but different size
 static inline hashmap *map_with_size(
     size_t size,
     void *(*copy) (const void *e),
     void (*del) (void *e)
 ) {
-  return map_with_hash(size, hashpjw, copy, del);
+  return map_with_hash(MAP_AVL, size, hash_wy, copy, del);
 }
 
 // Create a new hashmap
@@ -74,18 +134,29 @@ static inline hashmap *map_new(void *(*copy) (const void *e), void (*del) (void
   return map_with_size(211, copy, del);
 }
 
+// Create a new open addressing hashmap
+static inline hashmap *map_flat_new(void *(*copy) (const void *e), void (*del) (void *e)) {
+  return map_with_hash(MAP_FLAT, 16, hash_wy, copy, del);
+}
+
 // Delete a hashmap
-static inline void map_del(hashmap *m) {
-  // Free all of the trees
-  for (size_t i = 0; i < m->bucket_size; ++i)
-    avl_tree_del(m->buckets[i]);
-
-  //Free the buckets
-  free(m->buckets);
-  // Free the map itself
-  free(m);
+void map_del(hashmap *m);
+
+// Set how many entries per bucket a MAP_AVL map averages before it grows.
+// It shrinks again once it drops under a quarter of that
+static inline void map_set_load_factor(hashmap *m, float load_factor) {
+  m->load_factor = load_factor;
 }
 
+// Seed the hash function of a map. Only do this while the map is empty
+static inline void map_set_seed(hashmap *m, unsigned long seed) {
+  m->seed = seed;
+}
+
+// Make room for at least n entries up front so the map will not need
+// to rehash until it grows past that
+void map_reserve(hashmap *m, unsigned int n);
+
 // Insert into the map
 // The key must be a pointer to the thing you actually want to use
 void map_insert(
@@ -104,15 +175,28 @@ int map_get(hashmap *m, void **k, unsigned int key_size, unsigned int key_len, v
 // The key must be a pointer to the thing you actually want to use
 void map_remove(hashmap *m, void **k, unsigned int key_size, unsigned int key_len);
 
+/* Iteration without allocating */
+// Cursor over the entries of a hashmap in no particular order. Lives on the stack.
+// The map can't be touched while it's being walked, not even with map_get,
+// since that can move entries around while the map is rehashing
+typedef struct MapIter {
+    const hashmap *m;
+    // Next slot or bucket to look at
+    unsigned int i;
+    // Walking the buckets still waiting to be rehashed
+    bool old;
+    // Position inside of the current MAP_AVL bucket
+    avl_tree_iter tree;
+} map_iter;
+
+// Start a cursor at the first entry of the map
+void map_iter_init(map_iter *it, const hashmap *m);
+
+// Move to the next entry. Returns false once every entry has been seen
+bool map_iter_next(map_iter *it, hashmap_entry **e);
+
 // Get pairs in map
-static inline list *map_pairs(const hashmap *m) {
-  list *l = avl_tree_to_list(m->buckets[0]);
-  for (unsigned int i = 1; i < m->bucket_size; ++i)
-    l = list_concat_consume(l, avl_tree_to_list(m->buckets[i]), do_not_del);
-  // Reset deletion on list so we don't accidentally free the data
-  l->del = do_not_del;
-  return l;
-}
+list *map_pairs(const hashmap *m);
 // Get keys in map
 list *map_keys(const hashmap *m);
 // Get values in map
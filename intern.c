@@ -0,0 +1,62 @@
+#include "hash.h"
+#include "intern.h"
+
+// Create a new intern pool
+intern_pool *intern_pool_new() {
+  intern_pool *p = (intern_pool *) malloc(sizeof(intern_pool));
+  p->cap = 256;
+  p->len = 0;
+  p->slots = calloc(p->cap, sizeof(interned *));
+  p->strings = arena_new();
+  return p;
+}
+
+// Delete an intern pool and every string inside it
+void intern_pool_del(intern_pool *p) {
+  arena_del(p->strings);
+  free(p->slots);
+  free(p);
+}
+
+// Double the table and put every string back in
+static void intern_grow(intern_pool *p) {
+  unsigned int cap = p->cap * 2;
+  interned **slots = calloc(cap, sizeof(interned *));
+  for (unsigned int i = 0; i < p->cap; ++i) {
+    interned *s = p->slots[i];
+    if (s == NULL)
+      continue;
+    unsigned int j = s->hash & (cap - 1);
+    while (slots[j] != NULL)
+      j = (j + 1) & (cap - 1);
+    slots[j] = s;
+  }
+  free(p->slots);
+  p->slots = slots;
+  p->cap = cap;
+}
+
+// Intern len bytes of s
+char *intern(intern_pool *p, const char *s, unsigned int len) {
+  unsigned long hash = hash_wy(s, len, 0);
+  unsigned int i = hash & (p->cap - 1);
+
+  // Linear probe until we find the string or an empty slot
+  for (interned *e; (e = p->slots[i]) != NULL; i = (i + 1) & (p->cap - 1)) {
+    if (e->hash == hash && e->len == len && memcmp(e->str, s, len) == 0)
+      return e->str;
+  }
+
+  // Not seen before, so copy it into the pool
+  interned *e = arena_alloc(p->strings, sizeof(interned) + len + 1);
+  e->hash = hash;
+  e->len = len;
+  memcpy(e->str, s, len);
+  e->str[len] = '\0';
+  p->slots[i] = e;
+
+  // Keep the table at most half full
+  if (++p->len * 2 > p->cap)
+    intern_grow(p);
+  return e->str;
+}
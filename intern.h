@@ -0,0 +1,63 @@
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include "arena.h"
+
+// Header stored right in front of every interned string
+typedef struct Interned {
+    unsigned long hash;
+    unsigned int len;
+    char str[];
+} interned;
+
+// Pool of unique strings. Interning the same bytes twice gives back the same
+// pointer, so interned strings can be compared by pointer identity
+typedef struct InternPool {
+    // Open addressing table of every interned string
+    interned **slots;
+    unsigned int cap;
+    unsigned int len;
+    // Where the strings themselves live
+    arena *strings;
+} intern_pool;
+
+// Create a new intern pool
+intern_pool *intern_pool_new();
+
+// Delete an intern pool and every string inside it
+void intern_pool_del(intern_pool *p);
+
+// Intern len bytes of s. The returned string is null terminated and lives
+// as long as the pool does
+char *intern(intern_pool *p, const char *s, unsigned int len);
+
+// Intern a null terminated string
+static inline char *intern_str(intern_pool *p, const char *s) {
+  return intern(p, s, strlen(s));
+}
+
+// Get the header of an interned string
+static inline interned *intern_header(const char *id) {
+  return (interned *) (id - offsetof(interned, str));
+}
+
+// Get the hash computed when the string was interned
+static inline unsigned long intern_hash(const char *id) {
+  return intern_header(id)->hash;
+}
+
+// Get the length of an interned string
+static inline unsigned int intern_len(const char *id) {
+  return intern_header(id)->len;
+}
+
+// Hash function for hashmaps keyed by interned strings. Reads the cached hash,
+// so the map's seed has no effect
+static inline unsigned long intern_map_hash(const void *k, size_t n, unsigned long seed) {
+  return intern_hash((const char *) k);
+}
+
+#endif
@@ -0,0 +1,45 @@
+#include "ast.h"
+#include "keyword.h"
+#include "y.tab.h"
+
+/*
+ * The association values were found by searching for values between 0 and
+ * KEYWORD_COUNT - 1 that send every reserved word to a different slot of
+ * (len + assoc[first] + assoc[last]) % KEYWORD_COUNT. Adding or removing a
+ * word means searching again and reordering the table to match
+ */
+const unsigned char keyword_assoc[256] = {
+    ['a'] = 1, ['b'] = 5, ['d'] = 8, ['e'] = 8, ['f'] = 7, ['i'] = 13,
+    ['l'] = 1, ['m'] = 7, ['n'] = 6, ['o'] = 16, ['p'] = 10, ['r'] = 10,
+    ['t'] = 8, ['v'] = 10, ['w'] = 4, ['y'] = 8,
+};
+
+// Every reserved word, laid out by hash
+const keyword keywords[KEYWORD_COUNT] = {
+    {"while", 5, "WHILE", WHILE},
+    {"then", 4, "THEN", THEN},
+    {"end", 3, "END", END},
+    {"else", 4, "ELSE", ELSE},
+    {"function", 8, "FUNCTION", FUNCTION},
+    {"if", 2, "IF", IF},
+    {"var", 3, "VAR", VAR},
+    {"program", 7, "PROGRAM", PROGRAM},
+    {"of", 2, "OF", OF},
+    {"do", 2, "DO", DO},
+    {"procedure", 9, "PROCEDURE", PROCEDURE},
+    {"or", 2, "ADDOP", ADDOP, OR},
+    {"and", 3, "MULOP", MULOP, AND},
+    {"integer", 7, "INTEGER", INTEGER},
+    {"array", 5, "ARRAY", ARRAY},
+    {"real", 4, "REAL", REAL},
+    {"begin", 5, "BBEGIN", BBEGIN},
+};
+
+// Find the reserved word for a token (and operator value)
+const keyword *keyword_for_token(int token, int opval) {
+  for (unsigned int i = 0; i < KEYWORD_COUNT; ++i) {
+    if (keywords[i].token == token && keywords[i].opval == opval)
+      return &keywords[i];
+  }
+  return NULL;
+}
@@ -0,0 +1,47 @@
+#ifndef KEYWORD_H
+#define KEYWORD_H
+
+#include <stddef.h>
+#include <string.h>
+
+// Number of reserved words
+#define KEYWORD_COUNT 17
+
+// A reserved word and the token the scanner turns it into
+typedef struct Keyword {
+    // How it's spelled in the source
+    const char *word;
+    unsigned int len;
+    // Name of the token for traces and diagnostics
+    const char *name;
+    int token;
+    // Operator value for the keywords that are really operators (or, and), otherwise 0
+    int opval;
+} keyword;
+
+// Every reserved word, laid out by hash so each one sits in its own slot
+extern const keyword keywords[KEYWORD_COUNT];
+
+// Association values for keyword_hash, one per byte
+extern const unsigned char keyword_assoc[256];
+
+// Minimal perfect hash over the reserved words. Looks at the length and the first
+// and last characters only, folding case so case insensitive keywords would cost nothing
+static inline unsigned int keyword_hash(const char *s, unsigned int len) {
+  unsigned char first = (unsigned char) s[0] | 0x20;
+  unsigned char last = (unsigned char) s[len - 1] | 0x20;
+  return (len + keyword_assoc[first] + keyword_assoc[last]) % KEYWORD_COUNT;
+}
+
+// Look up a word, giving back NULL if it isn't reserved
+static inline const keyword *keyword_lookup(const char *s, unsigned int len) {
+  const keyword *k = &keywords[keyword_hash(s, len)];
+  if (k->len != len || memcmp(k->word, s, len) != 0)
+    return NULL;
+  return k;
+}
+
+// Find the reserved word for a token (and operator value), giving back NULL if there isn't one
+const keyword *keyword_for_token(int token, int opval);
+
+#endif
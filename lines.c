@@ -0,0 +1,57 @@
+#include <string.h>
+#include "lines.h"
+
+// Create a line table over len bytes of text
+line_table *line_table_new(const char *text, size_t len) {
+  line_table *t = malloc(sizeof(line_table));
+  t->text = text;
+  t->len = len;
+  t->starts = NULL;
+  t->count = 0;
+  return t;
+}
+
+// Delete a line table
+void line_table_del(line_table *t) {
+  free(t->starts);
+  free(t);
+}
+
+// Record where every line starts, if that hasn't happened yet
+void line_table_build(line_table *t) {
+  if (t->text == NULL || t->starts != NULL)
+    return;
+  unsigned int cap = 256;
+  t->starts = malloc(sizeof(unsigned int) * cap);
+  t->starts[0] = 0;
+  t->count = 1;
+  const char *end = t->text + t->len;
+  for (const char *p = t->text; (p = memchr(p, '\n', end - p)) != NULL;) {
+    if (t->count == cap) {
+      cap *= 2;
+      t->starts = realloc(t->starts, sizeof(unsigned int) * cap);
+    }
+    t->starts[t->count++] = (unsigned int) (++p - t->text);
+  }
+}
+
+// Find the line and column of an offset
+int line_table_find(line_table *t, unsigned int offset, location *loc) {
+  if (t->text == NULL)
+    return -1;
+  line_table_build(t);
+
+  // Find the last line starting at or before the offset
+  unsigned int lo = 0;
+  unsigned int hi = t->count;
+  while (hi - lo > 1) {
+    unsigned int mid = lo + (hi - lo) / 2;
+    if (t->starts[mid] <= offset)
+      lo = mid;
+    else
+      hi = mid;
+  }
+  loc->line = lo + 1;
+  loc->column = offset - t->starts[lo] + 1;
+  return 0;
+}
@@ -0,0 +1,50 @@
+#ifndef LINES_H
+#define LINES_H
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Line and column of a byte in a source, both counted from 1
+typedef struct Location {
+    unsigned int line;
+    unsigned int column;
+} location;
+
+// Where every line of a source starts. Tokens and nodes only carry byte offsets, so
+// this is the one place newlines get counted, and only once something asks
+typedef struct LineTable {
+    // Text the offsets are into, NULL if it isn't kept in memory
+    const char *text;
+    size_t len;
+    // Offset of the first byte of each line. NULL until the table gets built
+    unsigned int *starts;
+    unsigned int count;
+} line_table;
+
+// Create a line table over len bytes of text. The text has to outlive the table
+line_table *line_table_new(const char *text, size_t len);
+
+// Delete a line table
+void line_table_del(line_table *t);
+
+// Give a table made without any text the text it's over, for a source that only got read
+// into memory once scanning started. The text has to outlive the table
+static inline void line_table_set_text(line_table *t, const char *text, size_t len) {
+  t->text = text;
+  t->len = len;
+}
+
+// Record where every line starts, if that hasn't happened yet
+void line_table_build(line_table *t);
+
+// Check if the table has been built yet
+static inline bool line_table_is_built(const line_table *t) {
+  return t->starts != NULL;
+}
+
+// Find the line and column of an offset, building the table first if this is the
+// first lookup. Returns -1 if there's no text to look in
+int line_table_find(line_table *t, unsigned int offset, location *loc);
+
+#endif
@@ -94,6 +94,30 @@ static inline void *list_pop_back(list *l) {
   return list_pop(l, l->tail->prev);
 }
 
+/* Iteration without allocating */
+// Cursor over the elements of a list. Lives on the stack
+typedef struct ListIter {
+    const list *l;
+    list_node *n;
+    bool forward;
+} list_iter;
+
+// Start a cursor at the front (or the back when walking backwards) of the list
+static inline void list_iter_init(list_iter *it, const list *l, bool forward) {
+  it->l = l;
+  it->n = forward ? l->head : l->tail;
+  it->forward = forward;
+}
+
+// Move to the next element. Returns false once the whole list has been seen
+static inline bool list_iter_next(list_iter *it, void **e) {
+  it->n = it->forward ? it->n->next : it->n->prev;
+  if (it->n == it->l->tail || it->n == it->l->head)
+    return false;
+  *e = it->n->e;
+  return true;
+}
+
 /* Utility functions */
 // Reverses the list in place
 list *list_rev(list *l);
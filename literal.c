@@ -0,0 +1,78 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include "literal.h"
+
+// Every power of ten a double holds exactly
+static const double literal_pow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+// Convert a run of decimal digits into an int
+int literal_int(const char *s, unsigned int len, int *v) {
+  // Leading zeros never overflow anything
+  while (len > 1 && *s == '0') {
+    ++s;
+    --len;
+  }
+  // Too big gives back 0, so the token still has a value even though it's an error
+  *v = 0;
+  // INT_MAX has 10 digits, so anything longer is too big without looking
+  if (len > 10)
+    return -1;
+
+  uint64_t n = 0;
+  for (unsigned int i = 0; i < len; ++i)
+    n = n * 10 + (unsigned char) (s[i] - '0');
+  if (n > INT_MAX)
+    return -1;
+  *v = (int) n;
+  return 0;
+}
+
+// Convert digits "." digits the slow way. Only for literals with too many significant
+// digits to convert exactly. strtod rounds correctly and the locale is always "C" here
+static int literal_real_slow(const char *s, unsigned int len, double *v) {
+  char buf[64];
+  char *text = len < sizeof(buf) ? buf : malloc(len + 1);
+  memcpy(text, s, len);
+  text[len] = '\0';
+  errno = 0;
+  *v = strtod(text, NULL);
+  int overflow = errno == ERANGE && *v != 0.0;
+  if (text != buf)
+    free(text);
+  return overflow ? -1 : 0;
+}
+
+// Convert digits "." digits into the nearest double
+int literal_real(const char *s, unsigned int len, double *v) {
+  // Gather every digit into one integer, remembering how many came after the dot
+  uint64_t m = 0;
+  unsigned int digits = 0;
+  unsigned int scale = 0;
+  bool after_dot = false;
+  for (unsigned int i = 0; i < len; ++i) {
+    if (s[i] == '.') {
+      after_dot = true;
+      continue;
+    }
+    // Leading zeros don't count towards the precision
+    if (m != 0 || s[i] != '0')
+      ++digits;
+    m = m * 10 + (unsigned char) (s[i] - '0');
+    scale += after_dot;
+  }
+
+  // When the digits and the power of ten are both exact as doubles, one division
+  // rounds correctly. That's every literal anyone actually writes
+  if (digits <= 15 && scale < sizeof(literal_pow10) / sizeof(literal_pow10[0])) {
+    *v = (double) m / literal_pow10[scale];
+    return 0;
+  }
+  return literal_real_slow(s, len, v);
+}
@@ -0,0 +1,17 @@
+#ifndef LITERAL_H
+#define LITERAL_H
+
+/*
+ * Numeric literal conversion straight out of the scanner's buffer. Neither
+ * function needs the lexeme to be null terminated, looks at the locale or
+ * reads past len. Both give back -1 when the value doesn't fit, and still leave
+ * something defined in *v: 0 for integers and infinity for reals
+ */
+
+// Convert a run of decimal digits into an int
+int literal_int(const char *s, unsigned int len, int *v);
+
+// Convert digits "." digits into the nearest double
+int literal_real(const char *s, unsigned int len, double *v);
+
+#endif
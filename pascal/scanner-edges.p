@@ -0,0 +1,16 @@
+(* ERROR: integer literal too large, run under make scanner-check
+   so both scanners get compared on it *)
+program edges( input, output );
+  { a brace comment
+    over two lines } var a, b: integer;
+  var r: array[1..5] of real;   // ranges scan as 1 .. 5, not a real
+  var endless, iffy, dot: real;
+begin
+  (**) (*)*) (* ** *) (***)
+  a := 99999999999999999999;
+  b := a+1-2*3/4;
+  if a<>b then a := 1 else b := 2;
+  if (a<=b) or (a>=b) and (a==b) then r[1] := 1.5;
+  while a<b do a := a+1;
+  dot := 0.25; iffy := dot; endless := iffy
+end.
@@ -0,0 +1,7 @@
+(* ERROR: unterminated comment, and the program ends before it should *)
+program main( input, output );
+  var a: integer;
+begin
+  a := 1
+{ this comment never ends
+end.
@@ -1,34 +1,48 @@
+%code requires {
+#include "ast.h"
+// Locations are just the byte offset into the source a construct starts at
+#define YYLTYPE unsigned int
+#define YYLTYPE_IS_DECLARED 1
+// Everything the parser works on comes from here
+struct Compiler;
+}
+
 %{
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
 #include <string.h>
-#include "tree.h"
-#include "table_stack.h"
-#include "y.tab.h"
+#include <unistd.h>
+#include "compiler.h"
+#include "driver.h"
 
-int yylex();
-int yyerror(char *msg);
+// A construct starts where its first symbol does. Empty ones take the location of the symbol before them
+#define YYLLOC_DEFAULT(Cur, Rhs, N) ((Cur) = YYRHSLOC(Rhs, (N) ? 1 : 0))
 
-table_stack *symbol_table;
+// Starts every action that builds something. Checking syntax only skips them, leaving the parse
+// as nothing but scanning and table walks. Actions sit in a switch, so breaking out of one just
+// goes on to the next step of the parse
+#define SKIP_IF_SYNTAX_ONLY if (c->options.syntax_only) break
 
-void print_symbol(symbol *e) {
-  // TODO do checking on this stuff
-  if (e != NULL)
-    printf("Type: %d, Attribute: %p\n", e->type, e->attribute.sval);
-}
-
-extern FILE *yyin;
+int yylex(YYSTYPE *value, YYLTYPE *offset, compiler *c);
+int yyerror(YYLTYPE *offset, compiler *c, char *msg);
 %}
 
+// Nothing lives in globals, so any number of parses can run at once
+%define api.pure full
+%param {struct Compiler *c}
+
+%locations
+
 %union {
   int ival; // INUM
-  float rval; // RNUM
+  double rval; // RNUM
   int opval; // ADDOP, MULOP
   char *sval; // ID
 
-  tree_node *tval; // Tree node
+  ast_ref tval; // Tree node
+  vec *lval; // List still being read
 };
 
 // Tokens
@@ -67,27 +81,30 @@ extern FILE *yyin;
 
 // Types for grammar rules
 %type <tval> start
-%type <tval> identifier_list
-%type <tval> declarations
+%type <lval> identifier_list
+%type <lval> declarations
 %type <tval> type
 %type <tval> standard_type
-%type <tval> subprogram_declarations
+%type <lval> subprogram_declarations
 %type <tval> subprogram_declaration
 %type <tval> subprogram_head
 %type <tval> arguments
-%type <tval> parameter_list
+%type <lval> parameter_list
 %type <tval> compound_statement
 %type <tval> optional_statements
-%type <tval> statement_list
+%type <lval> statement_list
 %type <tval> statement
 %type <tval> variable
 %type <tval> for_loop
 %type <tval> procedure_statement
-%type <tval> expression_list
+%type <lval> expression_list
 %type <tval> expression
 %type <tval> simple_expression
 %type <tval> term
 %type <tval> factor
+
+// Lists still being read get thrown away when the parser gives up partway through them
+%destructor { if (!c->options.syntax_only && $$ != NULL) vec_del($$); } <lval>
 %%
 
 start: PROGRAM ID '(' identifier_list ')' ';'
@@ -96,61 +113,42 @@ start: PROGRAM ID '(' identifier_list ')' ';'
   compound_statement
   '.'
     {
+      SKIP_IF_SYNTAX_ONLY;
       // Create tree
-      tree_node *stmt = tree_make_from(symbol_new(COMPOUND_STATEMENT), $9, NULL);
-      tree_node *sub_dec = tree_make_from(symbol_new(SUBPROGRAM_DECLARATIONS), $8, stmt);
-      tree_node *dec = tree_make_from(symbol_new(DECLARATIONS), $7, sub_dec);
-      tree_node *id_list = tree_make_from(symbol_new(IDENTIFIER_LIST), $4, dec);
-
-      $$ = tree_make_from(symbol_new(PROGRAM), NULL, id_list);
-      ((symbol*) $$->e)->attribute.sval = $2;
-
-      tree_print_withr($$, print_symbol);
+      ast_ref ids = ast_make_list(c->syntax_tree, AST_IDENTIFIER_LIST, @4, $4);
+      ast_ref decs = ast_make_list(c->syntax_tree, AST_DECLARATIONS, @7, $7);
+      ast_ref subs = ast_make_list(c->syntax_tree, AST_SUBPROGRAM_DECLARATIONS, @8, $8);
+      ast_ref body = ast_make(c->syntax_tree, AST_BODY, @8, subs, $9);
+      ast_ref block = ast_make(c->syntax_tree, AST_BLOCK, @7, decs, body);
+      $$ = ast_make_with(c->syntax_tree, AST_PROGRAM, @1, ids, block, (ast_value) { .sval = $2 });
 
-      // Remove the global scope
-      table_stack_pop(symbol_table);
+      ast_print(c->syntax_tree, c->out);
+      c->program = $$;
     }
 ;
 
 identifier_list: ID
     {
-      // Create the symbol
-      symbol * s = symbol_new(ID);
-      s->attribute.sval = $1;
-      // Insert into the hashmap
-      table_stack_insert(symbol_table, $1, s);
-      // Add symbol into the tree
-      $$ = tree_make_from(s, NULL, NULL);
+      SKIP_IF_SYNTAX_ONLY;
+      // Add the identifier into the tree. What it declares gets worked out by the semantic pass
+      ast_ref id = ast_make_with(c->syntax_tree, AST_ID, @1, AST_NULL, AST_NULL, (ast_value) { .sval = $1 });
+      $$ = ast_list_push(NULL, id);
     }
   | identifier_list ',' ID
     {
-      // Create the symbol
-      symbol * s = symbol_new(ID);
-      s->attribute.sval = $3;
-      // Insert into the hashmap
-      table_stack_insert(symbol_table, $3, s);
-      // Add symbol into the tree
-      $$ = tree_make_from(symbol_new(COMMA), $1, tree_make_from(s, NULL, NULL));
+      SKIP_IF_SYNTAX_ONLY;
+      // Add the identifier into the tree
+      ast_ref id = ast_make_with(c->syntax_tree, AST_ID, @3, AST_NULL, AST_NULL, (ast_value) { .sval = $3 });
+      $$ = ast_list_push($1, id);
     }
 ;
 
 declarations: declarations VAR identifier_list ':' type ';'
     {
-      // TODO assign identifier types
-      // Create type and tree
-      symbol *type_s = symbol_new(TYPE);
-      type_s->attribute.sval = $5;
-      tree_node *type = tree_make_from(type_s, NULL, NULL);
-
-      // Create identifier list and tree
-      symbol * id_list_s = symbol_new(IDENTIFIER_LIST);
-      id_list_s->attribute.sval = $3;
-      tree_node *id_list = tree_make_from(id_list_s, NULL, type);
-
-      // Create tree
-      symbol * dec_s = symbol_new(DECLARATIONS);
-      dec_s->attribute.sval = $1;
-      $$ = tree_make_from(dec_s, NULL, id_list);
+      SKIP_IF_SYNTAX_ONLY;
+      ast_ref ids = ast_make_list(c->syntax_tree, AST_IDENTIFIER_LIST, @3, $3);
+      ast_ref var = ast_make(c->syntax_tree, AST_VAR, @2, ids, $5);
+      $$ = ast_list_push($1, var);
     }
   | // Nothing to do
     {
@@ -160,28 +158,36 @@ declarations: declarations VAR identifier_list ':' type ';'
 
 type: standard_type
     {
-      $$ = tree_make_from(symbol_new(TYPE), NULL, NULL);
+      $$ = $1;
     }
   | ARRAY '[' INUM DOTDOT INUM ']' OF standard_type
     {
+      SKIP_IF_SYNTAX_ONLY;
       // Make a tree node with proper bound checking on the array
-      $$ = tree_make_from(symbol_new(ARRAY_TYPE), NULL, NULL);
+      ast_ref low = ast_make_with(c->syntax_tree, AST_INUM, @3, AST_NULL, AST_NULL, (ast_value) { .ival = $3 });
+      ast_ref high = ast_make_with(c->syntax_tree, AST_INUM, @5, AST_NULL, AST_NULL, (ast_value) { .ival = $5 });
+      ast_ref range = ast_make(c->syntax_tree, AST_RANGE, @3, low, high);
+      const type *ty = type_array(c->types, $3, $5, c->syntax_tree->value[$8].type);
+      $$ = ast_make_with(c->syntax_tree, AST_ARRAY, @1, range, $8, (ast_value) { .type = ty });
     }
   ;
 
 standard_type: INTEGER
     {
-      $$ = tree_make_from(symbol_new(INTEGER), NULL, NULL);
+      SKIP_IF_SYNTAX_ONLY;
+      $$ = ast_make_with(c->syntax_tree, AST_INTEGER, @1, AST_NULL, AST_NULL, (ast_value) { .type = c->types->integer });
     }
   | REAL
     {
-      $$ = tree_make_from(symbol_new(REAL), NULL, NULL);
+      SKIP_IF_SYNTAX_ONLY;
+      $$ = ast_make_with(c->syntax_tree, AST_REAL, @1, AST_NULL, AST_NULL, (ast_value) { .type = c->types->real });
     }
   ;
 
 subprogram_declarations: subprogram_declarations subprogram_declaration ';'
     {
-      $$ = tree_make_from(symbol_new(SUBPROGRAM_DECLARATIONS), $1, $2);
+      SKIP_IF_SYNTAX_ONLY;
+      $$ = ast_list_push($1, $2);
     }
   | // Nothing to do
     {
@@ -191,47 +197,52 @@ subprogram_declarations: subprogram_declarations subprogram_declaration ';'
 
 subprogram_declaration: subprogram_head declarations subprogram_declarations compound_statement
     {
-      // TODO make a tree here
+      SKIP_IF_SYNTAX_ONLY;
       // Create tree
-      tree_node *stmt = tree_make_from(symbol_new(COMPOUND_STATEMENT), $4, NULL);
-      tree_node *sub_dec = tree_make_from(symbol_new(SUBPROGRAM_DECLARATIONS), $3, stmt);
-      tree_node *dec = tree_make_from(symbol_new(DECLARATIONS), $2, sub_dec);
-
-      $$ = tree_make_from(symbol_new(SUBPROGRAM_HEAD), $1, dec);
+      ast_ref decs = ast_make_list(c->syntax_tree, AST_DECLARATIONS, @2, $2);
+      ast_ref subs = ast_make_list(c->syntax_tree, AST_SUBPROGRAM_DECLARATIONS, @3, $3);
+      ast_ref body = ast_make(c->syntax_tree, AST_BODY, @3, subs, $4);
+      ast_ref block = ast_make(c->syntax_tree, AST_BLOCK, @2, decs, body);
+      $$ = ast_make(c->syntax_tree, AST_SUBPROGRAM, @1, $1, block);
     }
 ;
 
 subprogram_head: FUNCTION ID arguments ':' standard_type ';'
     {
-      symbol *sym = symbol_new(FUNCTION);
-      sym->attribute.sval = $2;
-      $$ = tree_make_from(sym, $3, $5);
+      SKIP_IF_SYNTAX_ONLY;
+      $$ = ast_make_with(c->syntax_tree, AST_FUNCTION, @1, $3, $5, (ast_value) { .sval = $2 });
     }
   | PROCEDURE ID arguments ';'
     {
-      symbol *sym = symbol_new(PROCEDURE);
-      sym->attribute.sval = $2;
-      $$ = tree_make_from(sym, $3, NULL);
+      SKIP_IF_SYNTAX_ONLY;
+      $$ = ast_make_with(c->syntax_tree, AST_PROCEDURE, @1, $3, AST_NULL, (ast_value) { .sval = $2 });
     }
   ;
 
 arguments: '(' parameter_list ')'
     {
-      $$ = $2;
+      SKIP_IF_SYNTAX_ONLY;
+      $$ = ast_make_list(c->syntax_tree, AST_PARAMETERS, @2, $2);
     }
   | // Nothing to do
     {
-      $$ = NULL;
+      $$ = AST_NULL;
     }
   ;
 
 parameter_list: identifier_list ':' type
     {
-      $$ = tree_make_from(symbol_new(PARAMETER), $1, $3);
+      SKIP_IF_SYNTAX_ONLY;
+      ast_ref ids = ast_make_list(c->syntax_tree, AST_IDENTIFIER_LIST, @1, $1);
+      ast_ref var = ast_make(c->syntax_tree, AST_VAR, @1, ids, $3);
+      $$ = ast_list_push(NULL, var);
     }
   | parameter_list ';' identifier_list ':' type
     {
-      $$ = tree_make_from(symbol_new(PARAMETER), $1, tree_make_from(symbol_new(PARAMETER), $3, $5));
+      SKIP_IF_SYNTAX_ONLY;
+      ast_ref ids = ast_make_list(c->syntax_tree, AST_IDENTIFIER_LIST, @3, $3);
+      ast_ref var = ast_make(c->syntax_tree, AST_VAR, @3, ids, $5);
+      $$ = ast_list_push($1, var);
     }
   ;
 
@@ -243,28 +254,31 @@ compound_statement: BBEGIN optional_statements END
 
 optional_statements: statement_list
     {
-      $$ = $1;
+      SKIP_IF_SYNTAX_ONLY;
+      $$ = ast_make_list(c->syntax_tree, AST_STATEMENT_LIST, @1, $1);
     }
   | // Nothing to do
     {
-      $$ = NULL;
+      $$ = AST_NULL;
     }
   ;
 
 statement_list: statement
     {
-      $$ = $1;
+      SKIP_IF_SYNTAX_ONLY;
+      $$ = ast_list_push(NULL, $1);
     }
   | statement_list ';' statement
     {
-      $$ = tree_make_from(symbol_new(STATEMENT_LIST), $1, $3);
+      SKIP_IF_SYNTAX_ONLY;
+      $$ = ast_list_push($1, $3);
     }
   ;
 
 statement: variable ASSIGNOP expression
     {
-      // Do semantic checking here
-      $$ = tree_make_from(symbol_new(ASSIGNOP), $1, $3);
+      SKIP_IF_SYNTAX_ONLY;
+      $$ = ast_make(c->syntax_tree, AST_ASSIGN, @1, $1, $3);
     }
   | procedure_statement
     {
@@ -276,71 +290,65 @@ statement: variable ASSIGNOP expression
     }
   | IF expression THEN statement ELSE statement
     {
-      symbol *else_s = symbol_new(ELSE);
-      tree_node *else_t = tree_make_from(else_s, $6, NULL);
-      symbol *then_s = symbol_new(THEN);
-      tree_node *then_t = tree_make_from(then_s, $4, else_t);
-      symbol *if_s = symbol_new(IF);
-      $$ = tree_make_from(if_s, $2, then_t);
+      SKIP_IF_SYNTAX_ONLY;
+      ast_ref then = ast_make(c->syntax_tree, AST_THEN, @3, $4, $6);
+      $$ = ast_make(c->syntax_tree, AST_IF, @1, $2, then);
     }
   | IF expression THEN statement
     {
-      $$ = tree_make_from(symbol_new(IF_THEN), $2, $4);
+      SKIP_IF_SYNTAX_ONLY;
+      ast_ref then = ast_make(c->syntax_tree, AST_THEN, @3, $4, AST_NULL);
+      $$ = ast_make(c->syntax_tree, AST_IF, @1, $2, then);
     }
   | WHILE expression DO statement
     {
-      $$ = tree_make_from(symbol_new(WHILE), $2, $4);
+      SKIP_IF_SYNTAX_ONLY;
+      $$ = ast_make(c->syntax_tree, AST_WHILE, @1, $2, $4);
     }
   ;
 
 variable: ID
     {
-      symbol *sym = NULL;
-      // See if the symbol exists
-      if (table_stack_get(symbol_table, $1, &sym) != 1) {
-        // If it does add it
-        $$ = tree_make_from(sym, NULL, NULL);
-      } else {
-        fprintf(stderr, "This is bad, symbol not found\n");
-        exit(1);
-      }
+      SKIP_IF_SYNTAX_ONLY;
+      $$ = ast_make_with(c->syntax_tree, AST_VARIABLE, @1, AST_NULL, AST_NULL, (ast_value) { .sval = $1 });
     }
   | ID '[' expression ']'
     {
-      $$ = NULL;
+      SKIP_IF_SYNTAX_ONLY;
+      $$ = ast_make_with(c->syntax_tree, AST_INDEX, @1, $3, AST_NULL, (ast_value) { .sval = $1 });
     }
 ;
 
 procedure_statement: ID
     {
-      $$ = tree_make_from(symbol_new(ID), NULL, NULL);
-      ((symbol *) $$->e)->attribute.sval = $1;
+      SKIP_IF_SYNTAX_ONLY;
+      $$ = ast_make_with(c->syntax_tree, AST_CALL, @1, AST_NULL, AST_NULL, (ast_value) { .sval = $1 });
     }
   | ID '(' expression_list ')'
     {
-      $$ = tree_make_from(symbol_new(FUNCTION_CALL), $3, NULL);
-      ((symbol *) $$->e)->attribute.sval = $1;
+      SKIP_IF_SYNTAX_ONLY;
+      ast_ref args = ast_make_list(c->syntax_tree, AST_EXPRESSION_LIST, @3, $3);
+      $$ = ast_make_with(c->syntax_tree, AST_CALL, @1, args, AST_NULL, (ast_value) { .sval = $1 });
     }
 ;
 
   for_loop: FOR variable ASSIGNOP expression TO expression DO compound_statement
   {
-    symbol *stmt_s = symbol_new(COMPOUND_STATEMENT);
-    tree_node *stmt_t = tree_make_from(else_s, $8, NULL);
-    symbol *do_s = symbol_new(DO);
-    tree_node *do_t = tree_make_from(then_s, $6, stmt_t);
-    symbol *assign_s = symbol_new(ASSIGNOP);
-    tree_node *assign_t = tree_make_from(assign_s, $2, $4);
-    $$ = tree_make_from(symbol_new(FOR), assign_t, do_s);
+    SKIP_IF_SYNTAX_ONLY;
+    ast_ref assign = ast_make(c->syntax_tree, AST_ASSIGN, @2, $2, $4);
+    ast_ref do_t = ast_make(c->syntax_tree, AST_DO, @5, $6, $8);
+    $$ = ast_make(c->syntax_tree, AST_FOR, @1, assign, do_t);
   };
 
-expression_list: expression expression_list
+expression_list: expression
     {
-      $$ = $1;
+      SKIP_IF_SYNTAX_ONLY;
+      $$ = ast_list_push(NULL, $1);
     }
   | expression_list ',' expression
     {
-      $$ = tree_make_from(symbol_new(COMMA), $1, $3);
+      SKIP_IF_SYNTAX_ONLY;
+      $$ = ast_list_push($1, $3);
     }
   ;
 
@@ -350,8 +358,8 @@ expression: simple_expression
     }
   | simple_expression RELOP simple_expression
     {
-      $$ = tree_make_from(symbol_new(RELOP), $1, $3);
-      ((symbol *) $$->e)->attribute.opval = $2;
+      SKIP_IF_SYNTAX_ONLY;
+      $$ = ast_make_with(c->syntax_tree, AST_RELOP, @2, $1, $3, (ast_value) { .opval = $2 });
     }
   ;
 
@@ -361,13 +369,13 @@ simple_expression: term
     }
   | ADDOP term
     {
-      $$ = tree_make_from(symbol_new(ADDOP), $2, NULL);
-      ((symbol *) $$->e)->attribute.opval = $1;
+      SKIP_IF_SYNTAX_ONLY;
+      $$ = ast_make_with(c->syntax_tree, AST_SIGN, @1, $2, AST_NULL, (ast_value) { .opval = $1 });
     }
   | simple_expression ADDOP term
     {
-      $$ = tree_make_from(symbol_new(ADDOP), $1, $3);
-      ((symbol *) $$->e)->attribute.opval = $2;
+      SKIP_IF_SYNTAX_ONLY;
+      $$ = ast_make_with(c->syntax_tree, AST_ADDOP, @2, $1, $3, (ast_value) { .opval = $2 });
     }
   ;
 
@@ -377,39 +385,36 @@ term: factor
     }
   | term MULOP factor
     {
-      $$ = tree_make_from(symbol_new(MULOP), $1, $3);
-      ((symbol *) $$->e)->attribute.opval = $2;
+      SKIP_IF_SYNTAX_ONLY;
+      $$ = ast_make_with(c->syntax_tree, AST_MULOP, @2, $1, $3, (ast_value) { .opval = $2 });
     }
   ;
 
 factor: ID
     {
-      symbol *sym;
-      // See if the symbol exists
-      if (table_stack_get(symbol_table, $1, &sym) != 1) {
-        // If it does add it
-        tree_make_from(sym, NULL, NULL);
-      } else {
-        fprintf(stderr, "This is bad, symbol not found\n");
-      }
+      SKIP_IF_SYNTAX_ONLY;
+      $$ = ast_make_with(c->syntax_tree, AST_VARIABLE, @1, AST_NULL, AST_NULL, (ast_value) { .sval = $1 });
     }
   | ID '(' expression_list ')'
     {
-      $$ = NULL;
+      SKIP_IF_SYNTAX_ONLY;
+      ast_ref args = ast_make_list(c->syntax_tree, AST_EXPRESSION_LIST, @3, $3);
+      $$ = ast_make_with(c->syntax_tree, AST_CALL, @1, args, AST_NULL, (ast_value) { .sval = $1 });
     }
   | ID '[' expression ']'
     {
-      $$ = NULL;
+      SKIP_IF_SYNTAX_ONLY;
+      $$ = ast_make_with(c->syntax_tree, AST_INDEX, @1, $3, AST_NULL, (ast_value) { .sval = $1 });
     }
   | INUM
     {
-      $$ = tree_make_from(symbol_new(INUM), NULL, NULL);
-      ((symbol *) $$->e)->attribute.ival = $1;
+      SKIP_IF_SYNTAX_ONLY;
+      $$ = ast_make_with(c->syntax_tree, AST_INUM, @1, AST_NULL, AST_NULL, (ast_value) { .ival = $1 });
     }
   | RNUM
     {
-      $$ = tree_make_from(symbol_new(RNUM), NULL, NULL);
-      ((symbol *) $$->e)->attribute.rval = $1;
+      SKIP_IF_SYNTAX_ONLY;
+      $$ = ast_make_with(c->syntax_tree, AST_RNUM, @1, AST_NULL, AST_NULL, (ast_value) { .rval = $1 });
     }
   | '(' expression ')'
     {
@@ -417,20 +422,68 @@ factor: ID
     }
   | NOT factor
     {
-      $$ = NULL;
+      SKIP_IF_SYNTAX_ONLY;
+      $$ = ast_make(c->syntax_tree, AST_NOT, @1, $2, AST_NULL);
     }
   ;
 
 %%
 
+// Syntax errors point at the token the parser choked on
+int yyerror(YYLTYPE *offset, compiler *c, char *msg) {
+  error_at(c, *offset, "%s", msg);
+  return 0;
+}
+
+// Hand the parser the next token out of the stream
+int yylex(YYSTYPE *value, YYLTYPE *offset, compiler *c) {
+  return token_stream_next(c->tokens, value, offset);
+}
+
 int main(int argc, char **argv) {
-  // Initialize the symbol table
-  symbol_table = table_stack_new();
-  // Add a global scope
-  table_stack_add(symbol_table);
-  if (argc > 1) {
-    yyin = fopen(argv[1], "r");
+  // Tracing can be turned on from the environment, and the command line wins
+  const char *trace = getenv("DRAGON_TRACE");
+  // Every source to compile, from the command line and any @response files
+  vec *paths = vec_new(simple_cmp, NULL, free);
+  // Sources get compiled this many at a time, one per processor unless told otherwise
+  long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+  compiler_options options = {0};
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--lex-thread") == 0) {
+      options.lex_thread = true;
+    } else if (strcmp(argv[i], "--syntax-only") == 0) {
+      options.syntax_only = true;
+    } else if (strcmp(argv[i], "--stats") == 0) {
+      options.stats = true;
+    } else if (strcmp(argv[i], "--dump-tokens") == 0) {
+      options.dump_tokens = true;
+    } else if (strcmp(argv[i], "--trace") == 0) {
+      trace = "text";
+    } else if (strncmp(argv[i], "--trace=", 8) == 0) {
+      trace = argv[i] + 8;
+    } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+      jobs = strtol(argv[++i], NULL, 10);
+    } else if (strncmp(argv[i], "-j", 2) == 0) {
+      jobs = strtol(argv[i] + 2, NULL, 10);
+    } else if (argv[i][0] == '@') {
+      if (driver_read_response(argv[i] + 1, paths) == -1) {
+        fprintf(stderr, "Couldn't read %s\n", argv[i] + 1);
+        exit(1);
+      }
+    } else {
+      driver_add(paths, argv[i]);
+    }
+  }
+  if (trace_init(trace) == -1) {
+    fprintf(stderr, "Unknown trace mode %s, expected text, binary or off\n", trace);
+    exit(1);
   }
 
-  return yyparse();
-}
\ No newline at end of file
+  unsigned int failed;
+  if (paths->len == 0)
+    failed = driver_compile(NULL, &options, stdout, stderr) == -1;
+  else
+    failed = driver_run((const char **) paths->data, paths->len, jobs > 0 ? (unsigned int) jobs : 1, &options);
+  vec_del(paths);
+  return failed != 0;
+}
@@ -0,0 +1,326 @@
+/*
+ * Hand written scanner. A drop in replacement for the flex scanner in pc.l
+ * that hands the parser the same tokens, values and locations. Build with
+ * SCANNER=hand to use it instead of flex.
+ *
+ * Blanks, comment bodies, identifiers and digit runs are chewed through 16
+ * bytes at a time with SSE2 when it's there. That's safe because sources
+ * always have SOURCE_PADDING zero bytes on the end, so a load that starts
+ * before the end of a source never runs off of it
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "compiler.h"
+#include "keyword.h"
+#include "literal.h"
+
+// Where a scanner is in its source
+typedef struct Scanner {
+    compiler *c;
+    // Buffer being scanned and where the scanner is in it
+    const char *base;
+    const char *pos;
+    const char *end;
+    // Buffer a stream got read into, if there was one
+    char *owned;
+    // Stream to read in before the first token
+    FILE *in;
+} scanner;
+
+// Each value and location goes to the token stream, which hands them on to the parser
+#define yylval (*value)
+#define yylloc (*offset)
+
+// Hand a token to the parser, tracing it on the way out when tracing is on
+#define TOKEN(t) do { TRACE_TOKEN(s->c->trace, #t, t, yylloc, TRACE_PLAIN, ival, 0); return t; } while (0)
+#define TOKEN_OP(t) do { TRACE_TOKEN(s->c->trace, #t, t, yylloc, TRACE_OP, opval, yylval.opval); return t; } while (0)
+#define TOKEN_INT(t) do { TRACE_TOKEN(s->c->trace, #t, t, yylloc, TRACE_INT, ival, yylval.ival); return t; } while (0)
+#define TOKEN_REAL(t) do { TRACE_TOKEN(s->c->trace, #t, t, yylloc, TRACE_REAL, rval, yylval.rval); return t; } while (0)
+#define TOKEN_STR(t) do { TRACE_TOKEN(s->c->trace, #t, t, yylloc, TRACE_STR, sval, yylval.sval); return t; } while (0)
+#define TOKEN_KEYWORD(k) \
+  do { \
+    yylval.opval = (k)->opval; \
+    TRACE_TOKEN(s->c->trace, (k)->name, (k)->token, yylloc, (k)->opval != 0 ? TRACE_OP : TRACE_PLAIN, opval, (k)->opval); \
+    return (k)->token; \
+  } while (0)
+
+// Create a scanner for a compilation
+void *scan_new(compiler *c) {
+  scanner *s = malloc(sizeof(scanner));
+  s->c = c;
+  s->base = s->pos = s->end = NULL;
+  s->owned = NULL;
+  s->in = NULL;
+  return s;
+}
+
+// Delete a scanner
+void scan_del(void *scanner) {
+  struct Scanner *s = scanner;
+  free(s->owned);
+  free(s);
+}
+
+// Scan a buffer in place. It needs SOURCE_PADDING zero bytes after the end
+void scan_buffer(void *scanner, char *base, size_t len) {
+  struct Scanner *s = scanner;
+  s->base = s->pos = base;
+  s->end = base + len;
+}
+
+// Build the line table. This scanner never writes into what it scans, so there's nothing to undo
+void scan_lines(void *scanner, line_table *t) {
+  (void) scanner;
+  line_table_build(t);
+}
+
+// Scan a stream. It gets read into memory when the first token is asked for
+void scan_stream(void *scanner, FILE *in) {
+  struct Scanner *s = scanner;
+  s->in = in;
+}
+
+// Read all of the stream into memory so it can be scanned like a mapped file
+static void scan_read(scanner *s) {
+  size_t cap = 1 << 16;
+  size_t len = 0;
+  s->owned = malloc(cap + SOURCE_PADDING);
+  size_t n;
+  while ((n = fread(s->owned + len, 1, cap - len, s->in)) > 0) {
+    len += n;
+    if (len == cap) {
+      cap *= 2;
+      s->owned = realloc(s->owned, cap + SOURCE_PADDING);
+    }
+  }
+  memset(s->owned + len, 0, SOURCE_PADDING);
+  scan_buffer(s, s->owned, len);
+  // Now there's text to count lines in. This can be on the lexer thread, so keep clear of reports
+  pthread_mutex_lock(&s->c->report_lock);
+  line_table_set_text(s->c->lines, s->owned, len);
+  pthread_mutex_unlock(&s->c->report_lock);
+}
+
+/* Runs of characters */
+#ifdef __SSE2__
+// Mask of the bytes in a block that are c
+static inline unsigned int scan_match(__m128i v, char c) {
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(c)));
+}
+
+// Mask of the bytes in a block between lo and hi. Anything past 0x7f is negative and never is
+static inline unsigned int scan_range(__m128i v, char lo, char hi) {
+  __m128i above = _mm_cmpgt_epi8(v, _mm_set1_epi8(lo - 1));
+  __m128i below = _mm_cmplt_epi8(v, _mm_set1_epi8(hi + 1));
+  return _mm_movemask_epi8(_mm_and_si128(above, below));
+}
+#endif
+
+// Skip over spaces and tabs
+static inline const char *scan_blanks(const char *p) {
+#ifdef __SSE2__
+  // Most runs are a single space, so don't bother loading a block for those
+  if (*p != ' ' && *p != '\t')
+    return p;
+  if (*++p != ' ' && *p != '\t')
+    return p;
+  for (;; p += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *) p);
+    unsigned int m = scan_match(v, ' ') | scan_match(v, '\t');
+    if (m != 0xffff)
+      return p + __builtin_ctz(~m);
+  }
+#else
+  while (*p == ' ' || *p == '\t')
+    ++p;
+  return p;
+#endif
+}
+
+// Skip over digits
+static inline const char *scan_digits(const char *p) {
+#ifdef __SSE2__
+  for (;; p += 16) {
+    unsigned int m = scan_range(_mm_loadu_si128((const __m128i *) p), '0', '9');
+    if (m != 0xffff)
+      return p + __builtin_ctz(~m);
+  }
+#else
+  while (*p >= '0' && *p <= '9')
+    ++p;
+  return p;
+#endif
+}
+
+// Skip over letters and digits
+static inline const char *scan_ident(const char *p) {
+#ifdef __SSE2__
+  for (;; p += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *) p);
+    // Setting 0x20 folds upper case onto lower case
+    __m128i folded = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    unsigned int m = scan_range(v, '0', '9') | scan_range(folded, 'a', 'z');
+    if (m != 0xffff)
+      return p + __builtin_ctz(~m);
+  }
+#else
+  while ((*p >= '0' && *p <= '9') || ((*p | 0x20) >= 'a' && (*p | 0x20) <= 'z'))
+    ++p;
+  return p;
+#endif
+}
+
+// Find the first c on or after p. Gives back end if the source runs out first
+static inline const char *scan_find(const char *p, const char *end, char c) {
+#ifdef __SSE2__
+  for (;; p += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *) p);
+    unsigned int m = scan_match(v, c) | scan_match(v, '\0');
+    while (m != 0) {
+      const char *q = p + __builtin_ctz(m);
+      // Zero bytes inside of the source are just part of the comment
+      if (*q != '\0' || q >= end)
+        return q < end ? q : end;
+      m &= m - 1;
+    }
+  }
+#else
+  while (p < end && *p != c)
+    ++p;
+  return p;
+#endif
+}
+
+// Skip a comment starting at p, or give back p if there isn't one there. { } and (* *)
+// comments can span lines and end at the first terminator, same as the flex scanner
+static const char *scan_comment(scanner *s, const char *p) {
+  const char *q;
+  if (p[0] == '/' && p[1] == '/')
+    return scan_find(p + 2, s->end, '\n');
+  if (p[0] == '{')
+    q = scan_find(p + 1, s->end, '}');
+  else if (p[0] == '(' && p[1] == '*')
+    for (q = scan_find(p + 2, s->end, '*'); q < s->end && q[1] != ')'; q = scan_find(q + 1, s->end, '*'));
+  else
+    return p;
+  // The rest of the source is the comment, so there's nothing left to scan
+  if (q >= s->end) {
+    error_at(s->c, (unsigned int) (p - s->base), "unterminated comment");
+    return s->end;
+  }
+  // Step over the } or the *)
+  return q + (*q == '*' ? 2 : 1);
+}
+
+// Scan one token, filling in its value and location
+int scan_token(void *scanner, YYSTYPE *value, YYLTYPE *offset) {
+  struct Scanner *s = scanner;
+  if (s->base == NULL)
+    scan_read(s);
+
+  const char *p = s->pos;
+  for (;;) {
+    p = scan_blanks(p);
+    yylloc = (unsigned int) (p - s->base);
+    if (*p == '\n') {
+      TRACE_TOKEN(s->c->trace, "EOL", '\n', yylloc, TRACE_PLAIN, ival, 0);
+      ++p;
+      continue;
+    }
+    const char *q = scan_comment(s, p);
+    if (q == p)
+      break;
+    p = q;
+  }
+
+  const char *start = p;
+  if (p >= s->end) {
+    s->pos = p;
+    return 0;
+  }
+
+  // Identifiers and keywords
+  if ((*p | 0x20) >= 'a' && (*p | 0x20) <= 'z') {
+    p = scan_ident(p + 1);
+    s->pos = p;
+    const keyword *k = keyword_lookup(start, p - start);
+    if (k != NULL)
+      TOKEN_KEYWORD(k);
+    yylval.sval = intern(s->c->identifiers, start, p - start);
+    TOKEN_STR(ID);
+  }
+
+  // Numbers. A dot only makes it real when digits follow it, so 1..5 is a range
+  if (*p >= '0' && *p <= '9') {
+    p = scan_digits(p + 1);
+    if (p[0] == '.' && p[1] >= '0' && p[1] <= '9') {
+      p = scan_digits(p + 2);
+      s->pos = p;
+      if (literal_real(start, p - start, &yylval.rval) == -1)
+        error_at(s->c, yylloc, "real literal out of range");
+      TOKEN_REAL(RNUM);
+    }
+    s->pos = p;
+    if (literal_int(start, p - start, &yylval.ival) == -1)
+      error_at(s->c, yylloc, "integer literal too large");
+    TOKEN_INT(INUM);
+  }
+
+  // Operators and punctuation
+  s->pos = p + 1;
+  switch (*p) {
+    case '.':
+      if (p[1] == '.') {
+        s->pos = p + 2;
+        TOKEN(DOTDOT);
+      }
+      break;
+    case ':':
+      if (p[1] == '=') {
+        s->pos = p + 2;
+        TOKEN(ASSIGNOP);
+      }
+      break;
+    case '<':
+      yylval.opval = LT;
+      if (p[1] == '=' || p[1] == '>') {
+        yylval.opval = p[1] == '=' ? LE : NE;
+        s->pos = p + 2;
+      }
+      TOKEN_OP(RELOP);
+    case '>':
+      yylval.opval = GT;
+      if (p[1] == '=') {
+        yylval.opval = GE;
+        s->pos = p + 2;
+      }
+      TOKEN_OP(RELOP);
+    case '=':
+      if (p[1] == '=') {
+        yylval.opval = EQ;
+        s->pos = p + 2;
+        TOKEN_OP(RELOP);
+      }
+      break;
+    case '+':
+      yylval.opval = PLUS;
+      TOKEN_OP(ADDOP);
+    case '-':
+      yylval.opval = MINUS;
+      TOKEN_OP(ADDOP);
+    case '*':
+      yylval.opval = STAR;
+      TOKEN_OP(MULOP);
+    case '/':
+      yylval.opval = SLASH;
+      TOKEN_OP(MULOP);
+  }
+
+  // Anything else is its own token
+  TRACE_TOKEN(s->c->trace, NULL, *p, yylloc, TRACE_PLAIN, ival, 0);
+  return *p;
+}
@@ -0,0 +1,434 @@
+#include <stdio.h>
+#include "semantic.h"
+
+// Room for a type spelled out in a diagnostic
+#define TYPE_NAME_SIZE 128
+
+// Where the check is up to
+typedef struct Checker {
+    compiler *c;
+    ast *t;
+    type_pool *types;
+    table_stack *s;
+    // Function whose body is being checked, NULL outside of functions
+    symbol *function;
+    // Depth of that function's own scope
+    unsigned int function_depth;
+    // Set once the function being checked assigns its result
+    bool returned;
+    // Slots handed out in the innermost scope so far
+    unsigned int slots;
+} checker;
+
+// Spell a type out for a diagnostic
+#define TYPE_NAME(ty) type_format((ty), (char[TYPE_NAME_SIZE]) {0}, TYPE_NAME_SIZE)
+
+/* Declarations */
+// Make a symbol in the next slot of the innermost scope and put it in scope under name
+static symbol *declare_name(checker *k, char *name, int kind, const type *ty) {
+  symbol *sym = symbol_new_in(k->c->symbol_arena, kind);
+  sym->attribute.sval = name;
+  sym->value_type = ty;
+  sym->depth = table_stack_len(k->s);
+  sym->slot = k->slots++;
+  symbol_array_add(k->c->symbols, sym);
+  table_stack_insert(k->s, name, sym);
+  return sym;
+}
+
+// Declare the identifier at node id in the innermost scope
+static symbol *declare(checker *k, ast_ref id, int kind, const type *ty) {
+  char *name = k->t->value[id].sval;
+  symbol *sym;
+  if (table_stack_get_local(k->s, name, &sym) != -1)
+    error_at(k->c, k->t->offset[id], "%s is already declared in this scope", name);
+
+  sym = declare_name(k, name, kind, ty);
+  k->t->symbols[id] = sym->index;
+  return sym;
+}
+
+// Declare something nobody wrote a declaration for
+static void declare_builtin(checker *k, const char *name, int kind, const type *ty) {
+  declare_name(k, intern_str(k->c->identifiers, name), kind, ty);
+}
+
+// Get the type a type node names, complaining about arrays that can't hold anything
+static const type *declared_type(checker *k, ast_ref n) {
+  const type *ty = k->t->value[n].type;
+  if (ty->kind == TYPE_ARRAY && ty->low > ty->high)
+    error_at(k->c, k->t->offset[n], "array bounds %d..%d are out of order", ty->low, ty->high);
+  return ty;
+}
+
+// Declare every identifier of a list of AST_VAR, the way declarations and parameters both are
+static void declare_vars(checker *k, ast_ref list) {
+  for (unsigned int i = 0; i < ast_list_len(k->t, list); ++i) {
+    ast_ref var = ast_list_children(k->t, list)[i];
+    const type *ty = declared_type(k, k->t->right[var]);
+    ast_ref ids = k->t->left[var];
+    for (unsigned int j = 0; j < ast_list_len(k->t, ids); ++j)
+      declare(k, ast_list_children(k->t, ids)[j], ID, ty);
+  }
+}
+
+// Get the signature of a subprogram out of its head
+static const type *signature(checker *k, ast_ref head) {
+  ast_ref params = k->t->left[head];
+  // Every identifier of a parameter group is a parameter of its own
+  unsigned int argc = 0;
+  for (unsigned int i = 0; i < ast_list_len(k->t, params); ++i)
+    argc += ast_list_len(k->t, k->t->left[ast_list_children(k->t, params)[i]]);
+
+  const type *local[16];
+  const type **args = argc <= sizeof(local) / sizeof(local[0]) ? local : malloc(sizeof(type *) * argc);
+  unsigned int argi = 0;
+  for (unsigned int i = 0; i < ast_list_len(k->t, params); ++i) {
+    ast_ref var = ast_list_children(k->t, params)[i];
+    const type *ty = k->t->value[k->t->right[var]].type;
+    for (unsigned int j = 0; j < ast_list_len(k->t, k->t->left[var]); ++j)
+      args[argi++] = ty;
+  }
+
+  const type *sig = k->t->kind[head] == AST_FUNCTION
+      ? type_function(k->types, k->t->value[k->t->right[head]].type, args, argc)
+      : type_procedure(k->types, args, argc);
+  if (args != local)
+    free(args);
+  return sig;
+}
+
+/* Names */
+// Look up the identifier a node uses, remembering what it resolved to
+// Returns NULL if it was never declared
+static binding *resolve(checker *k, ast_ref n) {
+  binding *b = table_stack_get_binding(k->s, k->t->value[n].sval);
+  if (b == NULL) {
+    error_at(k->c, k->t->offset[n], "symbol %s not found", k->t->value[n].sval);
+    return NULL;
+  }
+  k->t->symbols[n] = b->sym->index;
+  return b;
+}
+
+// Check the arguments of a call to sym against its signature
+static void check_args(checker *k, ast_ref n, const symbol *sym, ast_ref args) {
+  const type *sig = sym->value_type;
+  // Built in subprograms take anything
+  if (sig == NULL)
+    return;
+
+  unsigned int argc = ast_list_len(k->t, args);
+  if (argc != sig->argc) {
+    error_at(k->c, k->t->offset[n], "%s takes %u arguments, not %u", sym->attribute.sval, sig->argc, argc);
+    return;
+  }
+  for (unsigned int i = 0; i < argc; ++i) {
+    ast_ref arg = ast_list_children(k->t, args)[i];
+    const type *ty = k->t->types[arg];
+    if (ty != NULL && !type_eq(ty, sig->args[i]))
+      error_at(
+          k->c,
+          k->t->offset[arg],
+          "argument %u of %s should be %s, not %s",
+          i + 1,
+          sym->attribute.sval,
+          TYPE_NAME(sig->args[i]),
+          TYPE_NAME(ty)
+      );
+  }
+}
+
+/* Expressions */
+// Get the type of a call used as a value. Only functions give one back
+static const type *call_type(checker *k, ast_ref n, const symbol *sym, ast_ref args) {
+  if (sym->type == PROCEDURE) {
+    error_at(k->c, k->t->offset[n], "procedure %s does not return a value", sym->attribute.sval);
+    return NULL;
+  }
+  check_args(k, n, sym, args);
+  return sym->value_type->base;
+}
+
+// Get the type both sides of an operator share. Reports a mismatch and gives back NULL
+static const type *same_type(checker *k, ast_ref n, const type *a, const type *b) {
+  if (a == NULL || b == NULL)
+    return NULL;
+  if (!type_eq(a, b)) {
+    error_at(k->c, k->t->offset[n], "mismatched types %s and %s in expression", TYPE_NAME(a), TYPE_NAME(b));
+    return NULL;
+  }
+  return a;
+}
+
+// Make sure an operand is a number
+static const type *number(checker *k, ast_ref n, const type *ty) {
+  if (ty != NULL && !type_is_number(ty)) {
+    error_at(k->c, k->t->offset[n], "expected a number, not %s", TYPE_NAME(ty));
+    return NULL;
+  }
+  return ty;
+}
+
+// Make sure an operand is a boolean
+static const type *boolean(checker *k, ast_ref n, const type *ty) {
+  if (ty != NULL && ty != k->types->boolean) {
+    error_at(k->c, k->t->offset[n], "expected a boolean, not %s", TYPE_NAME(ty));
+    return NULL;
+  }
+  return ty;
+}
+
+// Work out the type of one expression node whose operands already have theirs
+static const type *type_node(checker *k, ast_ref n) {
+  ast *t = k->t;
+  const type *left = t->left[n] != AST_NULL ? t->types[t->left[n]] : NULL;
+  const type *right = t->right[n] != AST_NULL ? t->types[t->right[n]] : NULL;
+  binding *b;
+
+  switch (t->kind[n]) {
+    case AST_INUM:
+      return k->types->integer;
+    case AST_RNUM:
+      return k->types->real;
+
+    case AST_VARIABLE:
+      if ((b = resolve(k, n)) == NULL)
+        return NULL;
+      // A bare function name is a call with no arguments
+      if (b->sym->type == FUNCTION || b->sym->type == PROCEDURE)
+        return call_type(k, n, b->sym, AST_NULL);
+      return b->sym->value_type;
+
+    case AST_CALL:
+      if ((b = resolve(k, n)) == NULL)
+        return NULL;
+      if (b->sym->type != FUNCTION && b->sym->type != PROCEDURE) {
+        error_at(k->c, t->offset[n], "%s is not a function", t->value[n].sval);
+        return NULL;
+      }
+      return call_type(k, n, b->sym, t->left[n]);
+
+    case AST_INDEX:
+      if ((b = resolve(k, n)) == NULL)
+        return NULL;
+      if (left != NULL && left != k->types->integer)
+        error_at(k->c, t->offset[t->left[n]], "array index must be integer, not %s", TYPE_NAME(left));
+      if (b->sym->value_type == NULL || b->sym->value_type->kind != TYPE_ARRAY) {
+        error_at(k->c, t->offset[n], "%s is not an array", t->value[n].sval);
+        return NULL;
+      }
+      return b->sym->value_type->base;
+
+    case AST_ADDOP:
+    case AST_MULOP:
+      if (t->value[n].opval == OR || t->value[n].opval == AND)
+        return boolean(k, n, same_type(k, n, left, right));
+      return number(k, n, same_type(k, n, left, right));
+    case AST_RELOP:
+      return number(k, n, same_type(k, n, left, right)) != NULL ? k->types->boolean : NULL;
+    case AST_SIGN:
+      return number(k, n, left);
+    case AST_NOT:
+      return boolean(k, n, left);
+
+    // Argument lists don't have a type of their own
+    default:
+      return NULL;
+  }
+}
+
+// Type an expression and everything inside of it. Gives back NULL if it has no good type,
+// in which case whatever was wrong has been reported already
+static const type *check_expression(checker *k, ast_ref n) {
+  if (n == AST_NULL)
+    return NULL;
+  ast *t = k->t;
+  // The nodes of an expression are all made while parsing it, so they sit in one run that
+  // ends at the expression itself and starts at whichever leaf was made first
+  ast_ref first = n;
+  for (;;) {
+    if (t->kind[first] == AST_EXPRESSION_LIST)
+      first = ast_list_children(t, first)[0];
+    else if (t->left[first] != AST_NULL)
+      first = t->left[first];
+    else
+      break;
+  }
+  for (ast_ref i = first; i <= n; ++i)
+    t->types[i] = type_node(k, i);
+  return t->types[n];
+}
+
+/* Statements */
+static void check_statement(checker *k, ast_ref n);
+
+// Check what's being assigned to, giving back its type
+static const type *check_target(checker *k, ast_ref n) {
+  ast *t = k->t;
+  if (t->kind[n] == AST_INDEX)
+    return check_expression(k, n);
+
+  binding *b = resolve(k, n);
+  if (b == NULL)
+    return NULL;
+  symbol *sym = b->sym;
+  const type *ty = sym->value_type;
+  if (sym == k->function) {
+    // Assigning to the function's own name sets its result
+    k->returned = true;
+    ty = ty->base;
+  } else if (sym->type == FUNCTION || sym->type == PROCEDURE) {
+    error_at(k->c, t->offset[n], "can't assign to %s %s", sym->type == FUNCTION ? "function" : "procedure", sym->attribute.sval);
+    return NULL;
+  } else if (k->function != NULL && b->depth < k->function_depth) {
+    error_at(k->c, t->offset[n], "function %s can't assign to nonlocal %s", k->function->attribute.sval, sym->attribute.sval);
+  }
+  t->types[n] = ty;
+  return ty;
+}
+
+// Check the condition of an if or a while
+static void check_condition(checker *k, ast_ref n, const char *what) {
+  const type *ty = check_expression(k, n);
+  if (ty != NULL && ty != k->types->boolean)
+    error_at(k->c, k->t->offset[n], "%s condition must be boolean, not %s", what, TYPE_NAME(ty));
+}
+
+// Check one statement and everything inside of it
+static void check_statement(checker *k, ast_ref n) {
+  ast *t = k->t;
+  const type *a;
+  const type *b;
+  binding *callee;
+
+  switch (t->kind[n]) {
+    case AST_STATEMENT_LIST:
+      for (unsigned int i = 0; i < ast_list_len(t, n); ++i)
+        check_statement(k, ast_list_children(t, n)[i]);
+      break;
+
+    case AST_ASSIGN:
+      a = check_target(k, t->left[n]);
+      b = check_expression(k, t->right[n]);
+      if (a != NULL && b != NULL && !type_eq(a, b))
+        error_at(k->c, t->offset[n], "can't assign %s to %s", TYPE_NAME(b), TYPE_NAME(a));
+      break;
+
+    case AST_IF:
+      check_condition(k, t->left[n], "if");
+      check_statement(k, t->left[t->right[n]]);
+      check_statement(k, t->right[t->right[n]]);
+      break;
+
+    case AST_WHILE:
+      check_condition(k, t->left[n], "while");
+      check_statement(k, t->right[n]);
+      break;
+
+    case AST_FOR: {
+      ast_ref assign = t->left[n];
+      ast_ref body = t->right[n];
+      a = check_target(k, t->left[assign]);
+      b = check_expression(k, t->right[assign]);
+      const type *limit = check_expression(k, t->left[body]);
+      if (a != NULL && ((b != NULL && !type_eq(a, b)) || (limit != NULL && !type_eq(a, limit))))
+        error_at(k->c, t->offset[n], "for loop bounds must be %s like the loop variable", TYPE_NAME(a));
+      check_statement(k, t->right[body]);
+      break;
+    }
+
+    case AST_CALL:
+      // Type the arguments before holding them up against the signature
+      if (t->left[n] != AST_NULL)
+        check_expression(k, t->left[n]);
+      if ((callee = resolve(k, n)) == NULL)
+        break;
+      if (callee->sym->type == FUNCTION)
+        error_at(k->c, t->offset[n], "function %s called as a procedure", t->value[n].sval);
+      else if (callee->sym->type != PROCEDURE)
+        error_at(k->c, t->offset[n], "%s is not a procedure", t->value[n].sval);
+      else
+        check_args(k, n, callee->sym, t->left[n]);
+      break;
+
+    // An empty compound statement
+    case AST_EMPTY:
+      break;
+
+    default:
+      break;
+  }
+}
+
+/* Blocks */
+static void check_subprogram(checker *k, ast_ref n);
+
+// Check the declarations, subprograms and statements of a block inside of its scope
+static void check_block(checker *k, ast_ref block) {
+  ast *t = k->t;
+  declare_vars(k, t->left[block]);
+  ast_ref body = t->right[block];
+  ast_ref subs = t->left[body];
+  for (unsigned int i = 0; i < ast_list_len(t, subs); ++i)
+    check_subprogram(k, ast_list_children(t, subs)[i]);
+  check_statement(k, t->right[body]);
+}
+
+// Check a function or procedure. Its name goes in the enclosing scope, everything else in its own
+static void check_subprogram(checker *k, ast_ref n) {
+  ast *t = k->t;
+  ast_ref head = t->left[n];
+  bool is_function = t->kind[head] == AST_FUNCTION;
+  symbol *sym = declare(k, head, is_function ? FUNCTION : PROCEDURE, signature(k, head));
+
+  symbol *function = k->function;
+  unsigned int function_depth = k->function_depth;
+  bool returned = k->returned;
+  unsigned int slots = k->slots;
+  table_stack_add(k->s);
+  k->function = is_function ? sym : NULL;
+  k->function_depth = table_stack_len(k->s);
+  k->returned = false;
+  k->slots = 0;
+
+  declare_vars(k, t->left[head]);
+  check_block(k, t->right[n]);
+  if (is_function && !k->returned)
+    error_at(k->c, t->offset[head], "function %s never assigns its result", sym->attribute.sval);
+
+  table_stack_pop(k->s);
+  k->function = function;
+  k->function_depth = function_depth;
+  k->returned = returned;
+  k->slots = slots;
+}
+
+// Check a whole program
+int semantic_check(compiler *c, ast_ref program) {
+  unsigned int errors = atomic_load(&c->errors);
+  checker k = {
+      .c = c,
+      .t = c->syntax_tree,
+      .types = c->types,
+      .s = c->symbol_table,
+      .function = NULL,
+      .function_depth = 0,
+      .returned = false,
+      .slots = 0,
+  };
+  ast_annotate(k.t);
+
+  // The global scope holds what every program gets for free, then the program's own names
+  table_stack_add(k.s);
+  declare_builtin(&k, "read", PROCEDURE, NULL);
+  declare_builtin(&k, "write", PROCEDURE, NULL);
+  ast_ref ids = k.t->left[program];
+  // The program's parameters are files, which there's no type for
+  for (unsigned int i = 0; i < ast_list_len(k.t, ids); ++i)
+    declare(&k, ast_list_children(k.t, ids)[i], ID, NULL);
+  check_block(&k, k.t->right[program]);
+  table_stack_pop(k.s);
+
+  return atomic_load(&c->errors) != errors ? -1 : 0;
+}
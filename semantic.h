@@ -0,0 +1,22 @@
+#ifndef SEMANTIC_H
+#define SEMANTIC_H
+
+#include "compiler.h"
+
+/*
+ * Semantic analysis over a finished tree, following the rules in
+ * pascal/semantic-check-list.txt. The tree gets walked once. Every identifier
+ * is looked up exactly once and the index of the symbol it resolves to is kept
+ * on its node, along with the type of every expression, so later passes never
+ * have to look again.
+ *
+ * Statements and declarations are walked from the top down. Expressions are
+ * typed with a single sweep over their nodes in the order they were made, which
+ * always visits operands before the operators using them
+ */
+
+// Check a whole program, reporting everything wrong with it.
+// Returns -1 if anything was
+int semantic_check(compiler *c, ast_ref program);
+
+#endif
@@ -0,0 +1,66 @@
+// mmap flags and fdopen are outside of plain C11
+#define _DEFAULT_SOURCE
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "source.h"
+
+// Map a regular file with SOURCE_PADDING zero bytes after it. Returns -1 if it couldn't be
+static int source_map(source *s, int fd, size_t len) {
+  size_t page = (size_t) sysconf(_SC_PAGESIZE);
+  size_t map_len = (len + SOURCE_PADDING + page - 1) & ~(page - 1);
+
+  // Reserve zeroed memory for the file and its padding first. If the file ends right
+  // on a page boundary the padding is a page of its own, and touching the part of a
+  // file mapping that runs past the end of the file would fault instead
+  char *p = mmap(NULL, map_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == MAP_FAILED)
+    return -1;
+
+  // Then lay the file over the front of it. Private and writable since flex
+  // drops null terminators into the buffer as it scans
+  if (len > 0 && mmap(p, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+    munmap(p, map_len);
+    return -1;
+  }
+
+  s->data = p;
+  s->len = len;
+  s->map_len = map_len;
+  s->stream = NULL;
+  return 0;
+}
+
+// Open a source file
+int source_open(source *s, const char *path) {
+  int fd = open(path, O_RDONLY);
+  if (fd == -1)
+    return -1;
+
+  struct stat st;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && source_map(s, fd, (size_t) st.st_size) == 0) {
+    // The mapping holds its own reference to the file
+    close(fd);
+    return 0;
+  }
+
+  // Couldn't map it, so stream it
+  s->data = NULL;
+  s->len = s->map_len = 0;
+  if ((s->stream = fdopen(fd, "r")) == NULL) {
+    close(fd);
+    return -1;
+  }
+  return 0;
+}
+
+// Close a source, unmapping it if it was mapped
+void source_close(source *s) {
+  if (s->data != NULL)
+    munmap(s->data, s->map_len);
+  else if (s->stream != NULL && s->stream != stdin)
+    fclose(s->stream);
+  s->data = NULL;
+  s->stream = NULL;
+}
@@ -0,0 +1,42 @@
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Zero bytes kept after the end of a mapped source. Flex needs two of them to scan
+// a buffer in place, and the hand written scanner reads up to 16 bytes at a time
+#define SOURCE_PADDING 32
+
+// A source file to compile. Regular files are mapped straight into memory,
+// anything that can't be (pipes, terminals) is read as a stream instead
+typedef struct Source {
+    // The contents followed by SOURCE_PADDING zero bytes, NULL when streaming
+    char *data;
+    size_t len;
+    // Size of the whole mapping, padding included
+    size_t map_len;
+    // Set instead of data when streaming
+    FILE *stream;
+} source;
+
+// Open a source file. Returns -1 if it couldn't be opened
+int source_open(source *s, const char *path);
+
+// Use stdin as the source
+static inline void source_stdin(source *s) {
+  s->data = NULL;
+  s->len = s->map_len = 0;
+  s->stream = stdin;
+}
+
+// Check if the source is mapped into memory rather than streamed
+static inline bool source_is_mapped(const source *s) {
+  return s->data != NULL;
+}
+
+// Close a source, unmapping it if it was mapped
+void source_close(source *s);
+
+#endif
@@ -1,48 +1,145 @@
 #include <string.h>
 #include "table_stack.h"
 
+// Create a new table_stack
+table_stack *table_stack_new() {
+  table_stack *s = (table_stack *) malloc(sizeof(table_stack));
+  // Identifiers are interned, so they hash and compare by pointer. The chains
+  // are owned by the map but the identifiers belong to the intern pool
+  s->table = map_with(
+      MAP_FLAT,
+      64,
+      intern_map_hash,
+      map_identity_entry_cmp,
+      map_simple_entry_copy,
+      map_key_preserve_entry_remove
+  );
+  s->scopes = NULL;
+  s->depth = 0;
+  s->frames = 0;
+  s->cap = 0;
+  s->local_lookups = 0;
+  s->local_skips = 0;
+  return s;
+}
 
-// Get the element from the first place in the stack if it exists at all
-// Returns -1 if it's not there at all
-int table_stack_get(
-    table_stack *s,
-    char *id,
-    symbol** sym_p
-) {
-  int val;
-  // Loop through all places in the list and see if it's in any of the maps
-  for (list_node *n = s->data->head->next; n != s->data->tail; n = n->next) {
-    if ((val = map_get(s->data->head->next->e, (void **) id, sizeof(char), strlen(id), (void **) sym_p)) != -1) {
-      break;
-    }
+// Delete a table_stack
+void table_stack_del(table_stack *s) {
+  // Unwind every open scope so all of the bindings are freed
+  while (s->depth > 0)
+    table_stack_pop(s);
+  map_del(s->table);
+  for (unsigned int i = 0; i < s->frames; ++i)
+    free(s->scopes[i]);
+  free(s->scopes);
+  free(s);
+}
+
+// Insert into the local-most scope of the stack
+void table_stack_insert(table_stack *s, char *id, symbol *sym) {
+  unsigned int len = intern_len(id);
+  binding_chain *chain;
+
+  // Find the chain for this identifier, making one the first time it is seen
+  if (map_get(s->table, (void **) id, sizeof(char), len, (void **) &chain) == -1) {
+    chain = malloc(sizeof(binding_chain));
+    chain->id = id;
+    chain->top = NULL;
+    map_insert(s->table, (void **) chain->id, sizeof(char), len, chain);
   }
 
-  // Return the result
-  return val;
+  // Redeclaring in the same scope just replaces the symbol
+  if (chain->top != NULL && chain->top->depth == s->depth) {
+    chain->top->sym = sym;
+    return;
+  }
+
+  // Hide the outer binding and record the new one in this scope's undo log
+  scope *sc = s->scopes[s->depth - 1];
+  sc->signature |= table_stack_signature_bit(id);
+  binding *b = sc->len < SCOPE_INLINE ? &sc->local[sc->len] : malloc(sizeof(binding));
+  ++sc->len;
+  b->sym = sym;
+  b->depth = s->depth;
+  b->chain = chain;
+  b->shadowed = chain->top;
+  b->prev = sc->log;
+  sc->log = b;
+  chain->top = b;
+}
+
+// Push a scope onto the stack
+void table_stack_push(table_stack *s, const hashmap *scope) {
+  table_stack_add(s);
+  map_iter it;
+  hashmap_entry *e;
+  for (map_iter_init(&it, scope); map_iter_next(&it, &e);)
+    table_stack_insert(s, e->key, e->value);
 }
 
-void printer(hashmap_entry *e) {
-  char *key = e->key;
-  symbol *value = e->value;
+// Pop a scope from the stack
+void table_stack_pop(table_stack *s) {
+  if (s->depth == 0)
+    return;
+
+  // Walk the undo log and put back whatever each binding was hiding. The log is
+  // newest first, so the bindings that spilled onto the heap all come before the inline ones
+  scope *sc = s->scopes[--s->depth];
+  binding *b = sc->log;
+  for (unsigned int i = sc->len; b != NULL; --i) {
+    binding *prev = b->prev;
+    b->chain->top = b->shadowed;
+    if (i > SCOPE_INLINE)
+      free(b);
+    b = prev;
+  }
+}
+
+// Copy the table_stack
+table_stack *table_stack_copy(const table_stack *s) {
+  table_stack *new_s = table_stack_new();
+  // Replay every scope from the outside in
+  for (unsigned int i = 0; i < s->depth; ++i) {
+    table_stack_add(new_s);
+    scope_iter it;
+    binding *b;
+    for (scope_iter_init(&it, s, i); scope_iter_next(&it, &b);)
+      table_stack_insert(new_s, b->chain->id, b->sym);
+  }
+  return new_s;
+}
+
+void printer(binding *b) {
   // Print the key
-  printf("  \"%s\": {\n", key);
+  printf("  \"%s\": {\n", b->chain->id);
 
   // Print the type number
-  printf("    type: %d,\n", value->type);
+  printf("    type: %d,\n", b->sym->type);
   // Print the attribute
   // TODO check on type
-  printf("    attribute: %d\n  }", value->attribute.ival);
+  printf("    attribute: %d\n  }", b->sym->attribute.ival);
 }
 
-// Print the table_stack
+// Print the table_stack, innermost scope first
 void table_stack_print(const table_stack *s) {
-  if (s->data->len == 0)
+  if (s->depth == 0)
     printf("{}");
 
-  for (list_node *n = s->data->head->next; n != s->data->tail; n = n->next) {
-    hashmap *scope = n->e;
-    map_print_with(scope, printer);
-    if (n->next != s->data->tail)
+  for (unsigned int i = s->depth; i > 0; --i) {
+    if (s->scopes[i - 1]->log != NULL)
+      printf("{\n");
+    else
+      printf("{");
+    scope_iter it;
+    binding *b;
+    for (scope_iter_init(&it, s, i - 1); scope_iter_next(&it, &b);) {
+      printer(b);
+      if (b->prev != NULL)
+        printf(",");
+      printf("\n");
+    }
+    printf("}");
+    if (i > 1)
       printf(",\n");
   }
 }
@@ -3,18 +3,30 @@
 
 #include <stdlib.h>
 #include <stdio.h>
-#include "stack.h"
 #include "list.h"
 #include "hashmap.h"
+#include "intern.h"
+#include "arena.h"
 
-//Define the TableStack type
-typedef stack table_stack;
+// Index of a symbol in a symbol_array
+typedef unsigned int symbol_ref;
+
+// Index 0 is never handed out, so it stands in for an identifier that didn't resolve
+#define SYMBOL_NULL 0
 
 typedef struct Symbol {
     int type;
+    // What the symbol holds or, for subprograms, its signature. NULL until it's declared
+    const struct Type *value_type;
+    // Where it lives: the depth of the scope it was declared in (the global scope is 1)
+    // and its slot among everything declared in that scope
+    unsigned int depth;
+    unsigned int slot;
+    // Its index in the compilation's symbol_array, SYMBOL_NULL until it's added to one
+    symbol_ref index;
     union {
         int ival;
-        float rval;
+        double rval;
         int opval;
         char *sval;
     } attribute;
@@ -23,21 +35,41 @@ typedef struct Symbol {
 static inline symbol *symbol_new(const int type) {
   symbol *new_s = (symbol *) malloc(sizeof(symbol));
   new_s->type = type;
+  new_s->value_type = NULL;
+  new_s->depth = new_s->slot = 0;
+  new_s->index = SYMBOL_NULL;
   return new_s;
 }
 
 static inline symbol *symbol_with(const int type, void *e) {
   symbol *new_s = (symbol *) malloc(sizeof(symbol));
   new_s->type = type;
+  new_s->value_type = NULL;
+  new_s->depth = new_s->slot = 0;
+  new_s->index = SYMBOL_NULL;
   new_s->attribute.sval = e;
   return new_s;
 }
 
+// Create a symbol out of an arena. It goes away with the arena, so never symbol_del it
+static inline symbol *symbol_new_in(arena *a, const int type) {
+  symbol *new_s = (symbol *) arena_alloc(a, sizeof(symbol));
+  new_s->type = type;
+  new_s->value_type = NULL;
+  new_s->depth = new_s->slot = 0;
+  new_s->index = SYMBOL_NULL;
+  return new_s;
+}
+
 // TODO fix this when you can tell it's a string for proper string copy
 static inline void *symbol_copy(const void *e) {
   symbol *s = (symbol*) e;
   // Create the new symbol
   symbol *new_s = symbol_new(s->type);
+  new_s->value_type = s->value_type;
+  new_s->depth = s->depth;
+  new_s->slot = s->slot;
+  new_s->index = SYMBOL_NULL;
   new_s->attribute.sval = s->attribute.sval;
   return new_s;
 }
@@ -48,38 +80,143 @@ static inline void symbol_del(void *e) {
   free(e);
 }
 
-// Create a new table_stack
-static inline table_stack *table_stack_new() {
-  table_stack *t = (table_stack*) stack_new(symbol_copy, symbol_del);
-  return t;
+// Every symbol of a compilation side by side, in the order they were declared. Once names
+// are resolved, passes refer to symbols by their index in here and never need the strings again
+typedef struct SymbolArray {
+    symbol **data;
+    unsigned int len;
+    unsigned int cap;
+} symbol_array;
+
+// Create a new symbol array
+static inline symbol_array *symbol_array_new() {
+  symbol_array *a = (symbol_array *) malloc(sizeof(symbol_array));
+  a->cap = 64;
+  a->data = malloc(sizeof(symbol *) * a->cap);
+  // Take up index 0 so it can mean "no symbol"
+  a->data[0] = NULL;
+  a->len = 1;
+  return a;
 }
-// Delete a table_stack
-static inline void table_stack_del(table_stack *s) {
-  list_del(s->data);
-  free(s);
+
+// Delete a symbol array. The symbols themselves belong to whoever made them
+static inline void symbol_array_del(symbol_array *a) {
+  free(a->data);
+  free(a);
 }
 
+// Add a symbol, giving back its index
+static inline symbol_ref symbol_array_add(symbol_array *a, symbol *sym) {
+  if (a->len == a->cap) {
+    a->cap *= 2;
+    a->data = realloc(a->data, sizeof(symbol *) * a->cap);
+  }
+  a->data[a->len] = sym;
+  sym->index = a->len;
+  return a->len++;
+}
+
+// Get the symbol at an index. SYMBOL_NULL gives back NULL
+static inline symbol *symbol_array_get(const symbol_array *a, symbol_ref r) {
+  return a->data[r];
+}
+
+// A single declaration of an identifier inside of one scope
+typedef struct Binding {
+    symbol *sym;
+    // Depth of the scope the binding was declared in (the global scope is 1)
+    unsigned int depth;
+    // The binding of the same identifier in an outer scope that this one hides
+    struct Binding *shadowed;
+    // The binding declared just before this one in the same scope (the undo log)
+    struct Binding *prev;
+    // The shadowing chain this binding lives on
+    struct BindingChain *chain;
+} binding;
+
+// Every live binding of one interned identifier, innermost scope first
+typedef struct BindingChain {
+    char *id;
+    binding *top;
+} binding_chain;
+
+// Bindings a scope holds inline before it has to go to the heap for more
+#define SCOPE_INLINE 8
+
+// One open scope. Most procedures only declare a handful of names, so those come
+// out of the inline storage and entering or leaving the scope never calls malloc
+typedef struct Scope {
+    // Undo log, newest binding first
+    binding *log;
+    // One bit per name declared in the scope, picked by its hash. A clear bit
+    // means the name definitely isn't declared here
+    unsigned long signature;
+    // Bindings declared in the scope. Only the first SCOPE_INLINE live inline
+    unsigned int len;
+    binding local[SCOPE_INLINE];
+} scope;
+
+// Scoped symbol table. One hashmap maps each interned identifier to its shadowing chain,
+// so a lookup is a single probe no matter how deeply the scopes are nested.
+// Each open scope keeps an undo log of the bindings it declared so it can be
+// unwound in time proportional to its own symbols
+typedef struct TableStack {
+    hashmap *table;
+    // Scope per nesting level, outermost first. Scopes are kept around once popped
+    // so the next one opened at the same depth reuses its storage
+    scope **scopes;
+    unsigned int depth;
+    // Number of scopes allocated so far
+    unsigned int frames;
+    unsigned int cap;
+    // Lookups in the innermost scope and how many of them its signature answered alone
+    unsigned long local_lookups;
+    unsigned long local_skips;
+} table_stack;
+
+// Create a new table_stack
+table_stack *table_stack_new();
+
+// Delete a table_stack
+void table_stack_del(table_stack *s);
+
 // Get the length of the table_stack
 static inline unsigned int table_stack_len(table_stack *s) {
-  return s->data->len;
+  return s->depth;
 }
 
-// Insert into the local-most scope of the stack
-static inline void table_stack_insert(
-    table_stack *s,
-    char *id,
-    symbol *sym
-) {
-  return map_insert((hashmap *) s->data->head->next->e, id, sizeof(char), strlen(id), sym);
+// Insert into the local-most scope of the stack. The id must be interned
+// Inserting an identifier already declared in that scope replaces its symbol
+void table_stack_insert(table_stack *s, char *id, symbol *sym);
+
+// Get the innermost binding of an interned identifier if it exists at all
+// Returns NULL if it's not there at all
+static inline binding *table_stack_get_binding(table_stack *s, char *id) {
+  binding_chain *chain;
+  if (map_get(s->table, (void **) id, sizeof(char), intern_len(id), (void **) &chain) == -1)
+    return NULL;
+  return chain->top;
 }
 
 // Get the element from the first place in the stack if it exists at all
 // Returns -1 if it's not there at all
-int table_stack_get(
+static inline int table_stack_get(
     table_stack *s,
     char *id,
     symbol** sym_p
-);
+) {
+  binding *b = table_stack_get_binding(s, id);
+  if (b == NULL)
+    return -1;
+  *sym_p = b->sym;
+  return 0;
+}
+
+// Get the bit an interned identifier sets in the signature of a scope it's declared in
+static inline unsigned long table_stack_signature_bit(const char *id) {
+  // The top bits of the hash, since the map probes with the bottom ones
+  return 1UL << (intern_hash(id) >> (sizeof(unsigned long) * 8 - 6));
+}
 
 // Get the top element off of the table_stack if it exists
 static inline int table_stack_get_local(
@@ -87,28 +224,64 @@ static inline int table_stack_get_local(
     char *id,
     symbol** sym_p
 ) {
-  return map_get(s->data->head->next->e, id, sizeof(char), strlen(id), (void **) sym_p);
+  ++s->local_lookups;
+  // Most names checked against the innermost scope are new ones, which the signature
+  // turns away without touching the map
+  if (s->depth == 0 || (s->scopes[s->depth - 1]->signature & table_stack_signature_bit(id)) == 0) {
+    ++s->local_skips;
+    return -1;
+  }
+  binding *b = table_stack_get_binding(s, id);
+  if (b == NULL || b->depth != s->depth)
+    return -1;
+  *sym_p = b->sym;
+  return 0;
 }
 
 // Add a new empty scope onto the stack
 static inline void table_stack_add(table_stack *s) {
-  list_push_front(s->data, map_new(symbol_copy, symbol_del));
+  // Only the first scope opened at a depth needs any memory
+  if (s->depth == s->frames) {
+    if (s->frames == s->cap) {
+      s->cap = s->cap == 0 ? 8 : s->cap*2;
+      s->scopes = realloc(s->scopes, sizeof(scope *) * s->cap);
+    }
+    s->scopes[s->frames++] = malloc(sizeof(scope));
+  }
+  scope *sc = s->scopes[s->depth++];
+  sc->log = NULL;
+  sc->signature = 0;
+  sc->len = 0;
 }
 
-// Push a scope onto the stack
-static inline void table_stack_push(table_stack *s, hashmap *scope) {
-  list_push_front(s->data, scope);
+// Cursor over the bindings declared in one scope, newest first. Lives on the stack
+typedef struct ScopeIter {
+    binding *next;
+} scope_iter;
+
+// Start a cursor over the scope at depth (0 is the outermost scope)
+static inline void scope_iter_init(scope_iter *it, const table_stack *s, unsigned int depth) {
+  it->next = depth < s->depth ? s->scopes[depth]->log : NULL;
 }
 
-// Pop a scope from the stack
-static inline hashmap *table_stack_pop(table_stack *s) {
-  return list_pop_front(s->data);
+// Move to the next binding. Returns false once the whole scope has been seen
+static inline bool scope_iter_next(scope_iter *it, binding **b) {
+  if (it->next == NULL)
+    return false;
+  *b = it->next;
+  it->next = it->next->prev;
+  return true;
 }
 
+// Push a scope onto the stack. Every entry of the map (interned char * to symbol *)
+// gets declared in a new scope. The map itself is left untouched
+void table_stack_push(table_stack *s, const hashmap *scope);
+
+// Pop a scope from the stack, uncovering whatever its bindings were hiding
+void table_stack_pop(table_stack *s);
+
 // Copy the table_stack
-static inline table_stack *table_stack_copy(const table_stack *s) {
-  return stack_copy(s);
-}
+table_stack *table_stack_copy(const table_stack *s);
 
 // Print the table_stack
 void table_stack_print(const table_stack *s);
@@ -0,0 +1,196 @@
+#define _DEFAULT_SOURCE
+#include <stdlib.h>
+#include <sched.h>
+#include "token.h"
+
+// Scan up to a batch worth of tokens. The end of input is always the last token of its batch
+static token_batch *token_batch_scan(void *scanner) {
+  token_batch *b = malloc(sizeof(token_batch));
+  b->next = NULL;
+  unsigned int i = 0;
+  int kind;
+  do {
+    kind = scan_token(scanner, &b->value[i], &b->offset[i]);
+    b->kind[i++] = kind;
+  } while (kind != 0 && i < TOKEN_BATCH_SIZE);
+  b->len = i;
+  return b;
+}
+
+// Check if a batch holds the end of input
+static inline bool token_batch_is_last(const token_batch *b) {
+  return b->kind[b->len - 1] == 0;
+}
+
+// Check if the lexer thread has room for another batch or has been told to stop
+static inline bool token_stream_has_space(token_stream *ts, unsigned long tail) {
+  return tail - atomic_load(&ts->ring_head) < TOKEN_RING_SIZE || atomic_load(&ts->stop);
+}
+
+// Check if there's a batch waiting for the parser
+static inline bool token_stream_has_batch(token_stream *ts, unsigned long head) {
+  return atomic_load(&ts->ring_tail) != head;
+}
+
+// Wake whoever is asleep on cond if its flag says they might be. The sleeper sets the flag
+// before its last check and we moved the ring before looking at the flag, so one of us
+// always sees the other
+static void token_stream_wake(token_stream *ts, atomic_bool *waiting, pthread_cond_t *cond) {
+  if (!atomic_load(waiting))
+    return;
+  pthread_mutex_lock(&ts->lock);
+  pthread_cond_signal(cond);
+  pthread_mutex_unlock(&ts->lock);
+}
+
+// Scan the whole source into the ring, waiting whenever the parser falls behind
+static void *token_stream_lex(void *arg) {
+  token_stream *ts = arg;
+  unsigned long tail = atomic_load_explicit(&ts->ring_tail, memory_order_relaxed);
+  while (!atomic_load_explicit(&ts->stop, memory_order_relaxed)) {
+    token_batch *b = token_batch_scan(ts->scanner);
+
+    // Spin a little, since the parser usually frees a slot soon, then sleep until it does
+    for (unsigned int spin = 0; !token_stream_has_space(ts, tail); ++spin) {
+      if (spin < TOKEN_SPIN) {
+        sched_yield();
+        continue;
+      }
+      pthread_mutex_lock(&ts->lock);
+      atomic_store(&ts->lexer_waiting, true);
+      while (!token_stream_has_space(ts, tail))
+        pthread_cond_wait(&ts->space, &ts->lock);
+      atomic_store(&ts->lexer_waiting, false);
+      pthread_mutex_unlock(&ts->lock);
+    }
+    if (atomic_load(&ts->stop)) {
+      free(b);
+      return NULL;
+    }
+
+    // The batch belongs to the parser once it's published, so look at it first
+    bool last = token_batch_is_last(b);
+    ts->ring[tail % TOKEN_RING_SIZE] = b;
+    // Publishing the tail publishes everything in the batch along with it
+    atomic_store(&ts->ring_tail, ++tail);
+    token_stream_wake(ts, &ts->parser_waiting, &ts->batches);
+    if (last)
+      break;
+  }
+  return NULL;
+}
+
+// Take the next batch off the ring, waiting for the lexer thread if it's empty
+static token_batch *token_stream_pop(token_stream *ts) {
+  unsigned long head = atomic_load_explicit(&ts->ring_head, memory_order_relaxed);
+  for (unsigned int spin = 0; !token_stream_has_batch(ts, head); ++spin) {
+    if (spin < TOKEN_SPIN) {
+      sched_yield();
+      continue;
+    }
+    pthread_mutex_lock(&ts->lock);
+    atomic_store(&ts->parser_waiting, true);
+    while (!token_stream_has_batch(ts, head))
+      pthread_cond_wait(&ts->batches, &ts->lock);
+    atomic_store(&ts->parser_waiting, false);
+    pthread_mutex_unlock(&ts->lock);
+  }
+  token_batch *b = ts->ring[head % TOKEN_RING_SIZE];
+  atomic_store(&ts->ring_head, head + 1);
+  token_stream_wake(ts, &ts->lexer_waiting, &ts->space);
+  return b;
+}
+
+// Create a stream over whatever the scanner has been pointed at
+token_stream *token_stream_new(void *scanner, bool threaded, bool keep) {
+  token_stream *ts = malloc(sizeof(token_stream));
+  ts->scanner = scanner;
+  ts->keep = keep;
+  ts->head = ts->batch = NULL;
+  ts->pos = 0;
+  ts->len = 0;
+  ts->threaded = threaded;
+  atomic_init(&ts->ring_head, 0);
+  atomic_init(&ts->ring_tail, 0);
+  atomic_init(&ts->stop, false);
+  atomic_init(&ts->lexer_waiting, false);
+  atomic_init(&ts->parser_waiting, false);
+  pthread_mutex_init(&ts->lock, NULL);
+  pthread_cond_init(&ts->space, NULL);
+  pthread_cond_init(&ts->batches, NULL);
+  if (threaded && pthread_create(&ts->lexer, NULL, token_stream_lex, ts) != 0)
+    ts->threaded = false;
+  return ts;
+}
+
+// Delete a stream, stopping the lexer thread if it's still going
+void token_stream_del(token_stream *ts) {
+  if (ts->threaded) {
+    atomic_store(&ts->stop, true);
+    // The lexer could be asleep waiting for space that's never coming
+    pthread_mutex_lock(&ts->lock);
+    pthread_cond_signal(&ts->space);
+    pthread_mutex_unlock(&ts->lock);
+    pthread_join(ts->lexer, NULL);
+    // Free whatever the parser never got to
+    unsigned long tail = atomic_load_explicit(&ts->ring_tail, memory_order_relaxed);
+    for (unsigned long i = ts->ring_head; i != tail; ++i)
+      free(ts->ring[i % TOKEN_RING_SIZE]);
+  }
+  token_batch *next;
+  for (token_batch *b = ts->head; b != NULL; b = next) {
+    next = b->next;
+    free(b);
+  }
+  pthread_mutex_destroy(&ts->lock);
+  pthread_cond_destroy(&ts->space);
+  pthread_cond_destroy(&ts->batches);
+  free(ts);
+}
+
+// Get the next token, filling in its value and location
+int token_stream_next(token_stream *ts, YYSTYPE *value, YYLTYPE *offset) {
+  token_batch *b = ts->batch;
+  if (b == NULL || ts->pos == b->len) {
+    // Stay on the end of input once it's been reached
+    if (b != NULL && token_batch_is_last(b)) {
+      *offset = b->offset[b->len - 1];
+      return 0;
+    }
+    token_batch *next = ts->threaded ? token_stream_pop(ts) : token_batch_scan(ts->scanner);
+    // Unless the stream keeps them, nothing looks back at a batch once the parser is done with it
+    if (b != NULL && ts->keep) {
+      b->next = next;
+    } else {
+      free(b);
+      ts->head = next;
+    }
+    ts->batch = b = next;
+    ts->pos = 0;
+  }
+  unsigned int i = ts->pos++;
+  ++ts->len;
+  *value = b->value[i];
+  *offset = b->offset[i];
+  return b->kind[i];
+}
+
+// Get the next token of a walk over the tokens a stream has kept
+int token_iter_next(token_iter *it, YYSTYPE *value, YYLTYPE *offset) {
+  const token_stream *ts = it->stream;
+  while (it->batch != NULL) {
+    // Only the tokens the parser has already had out of the batch it's reading count
+    unsigned int end = it->batch == ts->batch ? ts->pos : it->batch->len;
+    if (it->pos < end) {
+      unsigned int i = it->pos++;
+      *value = it->batch->value[i];
+      *offset = it->batch->offset[i];
+      return it->batch->kind[i];
+    }
+    if (it->batch == ts->batch)
+      break;
+    it->batch = it->batch->next;
+    it->pos = 0;
+  }
+  return 0;
+}
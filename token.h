@@ -0,0 +1,115 @@
+#ifndef TOKEN_H
+#define TOKEN_H
+
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <pthread.h>
+#include "y.tab.h"
+
+// Tokens scanned at a time
+#define TOKEN_BATCH_SIZE 4096
+// Batches the lexer thread can get ahead of the parser by
+#define TOKEN_RING_SIZE 64
+// Times either side of the ring checks again before going to sleep on it
+#define TOKEN_SPIN 64
+
+// A run of tokens, laid out as parallel arrays so a pass over just the kinds stays in cache
+typedef struct TokenBatch {
+    unsigned int len;
+    // The batch handed out after this one, when the stream keeps them
+    struct TokenBatch *next;
+    int kind[TOKEN_BATCH_SIZE];
+    YYLTYPE offset[TOKEN_BATCH_SIZE];
+    YYSTYPE value[TOKEN_BATCH_SIZE];
+} token_batch;
+
+// Every token of a source, scanned ahead of the parser in batches. Each batch is freed as
+// soon as the parser moves on to the next one, unless the stream was asked to keep them so
+// the tokens can be walked again without scanning twice
+typedef struct TokenStream {
+    // Scanner the tokens come out of
+    void *scanner;
+    // Set when batches stay around once the parser is done with them
+    bool keep;
+    // First batch still around, which is the one the parser is reading unless batches are kept
+    token_batch *head;
+    // Batch the parser is reading and where it's up to in it
+    token_batch *batch;
+    unsigned int pos;
+    // Tokens handed out so far
+    unsigned long len;
+
+    // Set when scanning happens on a thread of its own
+    bool threaded;
+    pthread_t lexer;
+    // Batches scanned by the lexer thread that the parser hasn't got to yet. Only the lexer
+    // moves ring_tail and only the parser moves ring_head
+    token_batch *ring[TOKEN_RING_SIZE];
+    _Atomic unsigned long ring_head;
+    _Atomic unsigned long ring_tail;
+    // Tells the lexer thread to give up when the stream is deleted early
+    atomic_bool stop;
+    // Where a side that's spun for too long sleeps until the other one moves the ring
+    pthread_mutex_t lock;
+    pthread_cond_t space;
+    pthread_cond_t batches;
+    // Set while the lexer is asleep waiting for space or the parser for a batch
+    atomic_bool lexer_waiting;
+    atomic_bool parser_waiting;
+} token_stream;
+
+// Where a walk over the tokens a stream has kept is up to
+typedef struct TokenIter {
+    const token_stream *stream;
+    const token_batch *batch;
+    unsigned int pos;
+} token_iter;
+
+/* Provided by whichever scanner is built in. Scanners carry all of their state around with them */
+// Create a scanner for a compilation
+void *scan_new(struct Compiler *c);
+
+// Delete a scanner
+void scan_del(void *scanner);
+
+// Scan a buffer in place. It needs SOURCE_PADDING zero bytes after the end
+void scan_buffer(void *scanner, char *base, size_t len);
+
+// Scan a stream
+void scan_stream(void *scanner, FILE *in);
+
+// Build the line table over the buffer being scanned as it was before any scanning, in case
+// the scanner writes into it. Does nothing once the table is built
+void scan_lines(void *scanner, struct LineTable *t);
+
+// Scan one token, filling in its value and location
+int scan_token(void *scanner, YYSTYPE *value, YYLTYPE *offset);
+
+// Create a stream over whatever the scanner has been pointed at, scanning on a thread of
+// its own if threaded is set. Scanning stays on the caller's thread if the thread can't be started.
+// Every batch is kept until the stream is deleted if keep is set
+token_stream *token_stream_new(void *scanner, bool threaded, bool keep);
+
+// Delete a stream, stopping the lexer thread if it's still going
+void token_stream_del(token_stream *ts);
+
+// Get the next token, filling in its value and location. Keeps giving back 0 at the end
+int token_stream_next(token_stream *ts, YYSTYPE *value, YYLTYPE *offset);
+
+// Get the number of tokens handed out so far
+static inline unsigned long token_stream_len(const token_stream *ts) {
+  return ts->len;
+}
+
+// Start a walk over every token handed out so far, oldest first. Only a stream that keeps its
+// batches has them all, and the walk can't be used past the next call to token_stream_next
+static inline token_iter token_stream_iter(const token_stream *ts) {
+  return (token_iter) { ts, ts->head, 0 };
+}
+
+// Get the next token of a walk, filling in its value and location. Gives back 0 once every
+// token handed out has been walked
+int token_iter_next(token_iter *it, YYSTYPE *value, YYLTYPE *offset);
+
+#endif
@@ -0,0 +1,143 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <float.h>
+#include "intern.h"
+#include "trace.h"
+
+trace_mode trace_active = TRACE_OFF;
+
+// Turn tracing on from a setting of "text", "binary" or "off"
+int trace_init(const char *setting) {
+  if (setting == NULL || strcmp(setting, "off") == 0)
+    trace_active = TRACE_OFF;
+  else if (strcmp(setting, "text") == 0)
+    trace_active = TRACE_TEXT;
+  else if (strcmp(setting, "binary") == 0)
+    trace_active = TRACE_BINARY;
+  else
+    return -1;
+  return 0;
+}
+
+// Create a new trace writing to out
+trace *trace_new(FILE *out) {
+  trace *t = malloc(sizeof(trace));
+  t->out = out;
+  t->len = 0;
+  return t;
+}
+
+// Delete a trace, writing out whatever is left in it
+void trace_del(trace *t) {
+  trace_flush(t);
+  free(t);
+}
+
+// Longest a text record can be, not counting the identifier in a TRACE_STR one. The
+// biggest is a real, which %f writes out as up to DBL_MAX_10_EXP + 1 digits, a sign and 7 more
+#define TRACE_TEXT_MAX (64 + DBL_MAX_10_EXP + 10)
+
+// Get how much snprintf really wrote into room bytes, given what it says it wanted to write
+static inline size_t trace_wrote(int w, size_t room) {
+  if (w < 0)
+    return 0;
+  return (size_t) w < room ? (size_t) w : room - 1;
+}
+
+// Format the records as text into one buffer and write it all at once
+static void trace_flush_text(trace *t) {
+  // Text goes out in chunks the size of buf. Only identifiers can make a record longer than TRACE_TEXT_MAX
+  char *out = t->buf;
+  size_t len = 0;
+  for (unsigned int i = 0; i < t->len; ++i) {
+    trace_record *r = &t->ring[i];
+    size_t room = sizeof(t->buf) - len;
+    if (room < TRACE_TEXT_MAX || (r->kind == TRACE_STR && room < TRACE_TEXT_MAX + intern_len(r->value.sval))) {
+      fwrite(out, 1, len, t->out);
+      len = 0;
+      room = sizeof(t->buf);
+      // Absurdly long identifiers skip the buffer altogether
+      if (r->kind == TRACE_STR && room < TRACE_TEXT_MAX + intern_len(r->value.sval)) {
+        fprintf(t->out, "[%s:%s]", r->name, r->value.sval);
+        continue;
+      }
+    }
+
+    if (r->token == '\n') {
+      len += trace_wrote(snprintf(out + len, room, "[EOL]\n"), room);
+      continue;
+    }
+    if (r->name == NULL) {
+      len += trace_wrote(snprintf(out + len, room, "[%c]", r->token), room);
+      continue;
+    }
+    switch (r->kind) {
+      case TRACE_PLAIN:
+        len += trace_wrote(snprintf(out + len, room, "[%s]", r->name), room);
+        break;
+      case TRACE_INT:
+        len += trace_wrote(snprintf(out + len, room, "[%s:%d]", r->name, r->value.ival), room);
+        break;
+      case TRACE_REAL:
+        len += trace_wrote(snprintf(out + len, room, "[%s:%f]", r->name, r->value.rval), room);
+        break;
+      case TRACE_OP:
+        len += trace_wrote(snprintf(out + len, room, "[%s:%d]", r->name, r->value.opval), room);
+        break;
+      case TRACE_STR:
+        len += trace_wrote(snprintf(out + len, room, "[%s:%s]", r->name, r->value.sval), room);
+        break;
+    }
+  }
+  fwrite(out, 1, len, t->out);
+}
+
+// Pack the records as token, offset and value, 16 bytes each
+static void trace_flush_binary(trace *t) {
+  struct Packed {
+      int32_t token;
+      uint32_t offset;
+      uint64_t value;
+  } *out = (struct Packed *) t->buf;
+  _Static_assert(sizeof(struct Packed) * TRACE_RING_SIZE <= sizeof(t->buf), "buf can't hold a full ring");
+  for (unsigned int i = 0; i < t->len; ++i) {
+    trace_record *r = &t->ring[i];
+    out[i].token = r->token;
+    out[i].offset = r->offset;
+    out[i].value = 0;
+    // Strings are written as their length, the text itself is in the source at offset
+    if (r->kind == TRACE_STR)
+      out[i].value = intern_len(r->value.sval);
+    else if (r->kind == TRACE_REAL)
+      memcpy(&out[i].value, &r->value.rval, sizeof(double));
+    else if (r->kind != TRACE_PLAIN)
+      memcpy(&out[i].value, &r->value, sizeof(int));
+  }
+  fwrite(out, sizeof(out[0]), t->len, t->out);
+}
+
+// Write out everything in the ring buffer
+void trace_flush(trace *t) {
+  if (t->len == 0)
+    return;
+  if (trace_active == TRACE_BINARY)
+    trace_flush_binary(t);
+  else
+    trace_flush_text(t);
+  fflush(t->out);
+  t->len = 0;
+}
+
+// Record a token
+void trace_token(trace *t, const char *name, int token, unsigned int offset, trace_kind kind, trace_value value) {
+  if (t->len == TRACE_RING_SIZE)
+    trace_flush(t);
+  trace_record *r = &t->ring[t->len++];
+  r->name = name;
+  r->token = token;
+  r->offset = offset;
+  r->kind = kind;
+  r->value = value;
+}
@@ -0,0 +1,91 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+/*
+ * Token trace for the scanner. Off unless asked for with --trace or the
+ * DRAGON_TRACE environment variable. Records go into a ring buffer and are
+ * only written out when it fills up or the trace is deleted, so a trace costs
+ * one write per few thousand tokens. With tracing off a token costs a single
+ * branch and no I/O at all
+ */
+
+// Number of records held before they are written out
+#define TRACE_RING_SIZE 4096
+
+// Where the trace goes
+typedef enum TraceMode {
+    TRACE_OFF,
+    // One "[NAME:value]" per token like the scanner used to print
+    TRACE_TEXT,
+    // Packed 16 byte records of token, source offset and value
+    TRACE_BINARY
+} trace_mode;
+
+// Which member of the value a record uses
+typedef enum TraceKind {
+    TRACE_PLAIN,
+    TRACE_INT,
+    TRACE_REAL,
+    TRACE_OP,
+    TRACE_STR
+} trace_kind;
+
+typedef union TraceValue {
+    int ival;
+    double rval;
+    int opval;
+    const char *sval;
+} trace_value;
+
+// One traced token
+typedef struct TraceRecord {
+    // Printed name of the token, NULL for single characters
+    const char *name;
+    int token;
+    // Byte offset of the token in the source
+    unsigned int offset;
+    trace_kind kind;
+    trace_value value;
+} trace_record;
+
+// Records from one scanner waiting to be written. Each compilation has its own,
+// so sources scanned at the same time don't share anything but the mode
+typedef struct Trace {
+    // Where the records get written
+    FILE *out;
+    trace_record ring[TRACE_RING_SIZE];
+    unsigned int len;
+    // Where records get formatted or packed on the way out
+    _Alignas(max_align_t) char buf[1 << 16];
+} trace;
+
+// Current mode. Set once up front and checked before every record so disabled tracing stays free
+extern trace_mode trace_active;
+
+// Turn tracing on from a setting of "text", "binary" or "off". NULL leaves it off.
+// Returns -1 if the setting isn't one of those
+int trace_init(const char *setting);
+
+// Create a new trace writing to out
+trace *trace_new(FILE *out);
+
+// Delete a trace, writing out whatever is left in it
+void trace_del(trace *t);
+
+// Write out everything in the ring buffer
+void trace_flush(trace *t);
+
+// Record a token. Only called when tracing is on
+void trace_token(trace *t, const char *name, int token, unsigned int offset, trace_kind kind, trace_value value);
+
+// Record a token in t if tracing is on, using field of the value
+#define TRACE_TOKEN(t, name, token, offset, kind, field, v) \
+  do { \
+    if (trace_active != TRACE_OFF) \
+      trace_token(t, name, token, offset, kind, (trace_value) { .field = (v) }); \
+  } while (0)
+
+#endif
@@ -0,0 +1,172 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "hash.h"
+#include "type.h"
+
+// Make a type out of the arena with room for argc parameters
+static type *type_alloc(type_pool *p, type_kind kind, unsigned int argc) {
+  type *t = arena_alloc(p->types, sizeof(type) + argc * sizeof(type *));
+  t->kind = kind;
+  t->hash = 0;
+  t->low = 0;
+  t->high = 0;
+  t->base = NULL;
+  t->argc = argc;
+  return t;
+}
+
+// Create a new type pool
+type_pool *type_pool_new() {
+  type_pool *p = (type_pool *) malloc(sizeof(type_pool));
+  p->cap = 64;
+  p->len = 0;
+  p->slots = calloc(p->cap, sizeof(type *));
+  p->types = arena_new();
+  // These have no parts to tell them apart, so they never need to go in the table
+  p->integer = type_alloc(p, TYPE_INTEGER, 0);
+  p->real = type_alloc(p, TYPE_REAL, 0);
+  p->boolean = type_alloc(p, TYPE_BOOLEAN, 0);
+  return p;
+}
+
+// Delete a type pool and every type inside it
+void type_pool_del(type_pool *p) {
+  arena_del(p->types);
+  free(p->slots);
+  free(p);
+}
+
+// Hash the parts of a type. The parts are unique already, so their addresses stand in for them
+static unsigned long type_hash(type_kind kind, int low, int high, const type *base, const type **args, unsigned int argc) {
+  uint64_t head[] = { kind, (uint32_t) low, (uint32_t) high, (uintptr_t) base, argc };
+  unsigned long seed = hash_wy(head, sizeof(head), 0);
+  return hash_wy(args, argc * sizeof(type *), seed);
+}
+
+// Double the table and put every type back in
+static void type_grow(type_pool *p) {
+  unsigned int cap = p->cap * 2;
+  type **slots = calloc(cap, sizeof(type *));
+  for (unsigned int i = 0; i < p->cap; ++i) {
+    type *t = p->slots[i];
+    if (t == NULL)
+      continue;
+    unsigned int j = t->hash & (cap - 1);
+    while (slots[j] != NULL)
+      j = (j + 1) & (cap - 1);
+    slots[j] = t;
+  }
+  free(p->slots);
+  p->slots = slots;
+  p->cap = cap;
+}
+
+// Get the one type with these parts, making it the first time it's asked for
+static const type *type_intern(
+    type_pool *p,
+    type_kind kind,
+    int low,
+    int high,
+    const type *base,
+    const type **args,
+    unsigned int argc
+) {
+  unsigned long hash = type_hash(kind, low, high, base, args, argc);
+  unsigned int i = hash & (p->cap - 1);
+
+  // Linear probe until we find the type or an empty slot. Only the immediate parts get compared
+  for (type *t; (t = p->slots[i]) != NULL; i = (i + 1) & (p->cap - 1)) {
+    if (t->hash == hash && t->kind == kind && t->low == low && t->high == high && t->base == base
+        && t->argc == argc && (argc == 0 || memcmp(t->args, args, argc * sizeof(type *)) == 0))
+      return t;
+  }
+
+  // Not seen before, so make it
+  type *t = type_alloc(p, kind, argc);
+  t->hash = hash;
+  t->low = low;
+  t->high = high;
+  t->base = base;
+  if (argc > 0)
+    memcpy(t->args, args, argc * sizeof(type *));
+  p->slots[i] = t;
+
+  // Keep the table at most half full
+  if (++p->len * 2 > p->cap)
+    type_grow(p);
+  return t;
+}
+
+// Get the type array[low..high] of elem
+const type *type_array(type_pool *p, int low, int high, const type *elem) {
+  return type_intern(p, TYPE_ARRAY, low, high, elem, NULL, 0);
+}
+
+// Get the type of a function
+const type *type_function(type_pool *p, const type *result, const type **args, unsigned int argc) {
+  return type_intern(p, TYPE_FUNCTION, 0, 0, result, args, argc);
+}
+
+// Get the type of a procedure
+const type *type_procedure(type_pool *p, const type **args, unsigned int argc) {
+  return type_intern(p, TYPE_PROCEDURE, 0, 0, NULL, args, argc);
+}
+
+// Write a type into buf starting at len, giving back the new length. Stops writing once buf is full
+static size_t type_format_at(const type *t, char *buf, size_t n, size_t len) {
+#define APPEND(...) \
+  do { \
+    int w = snprintf(buf + len, n - len, __VA_ARGS__); \
+    len += w > 0 ? (size_t) w : 0; \
+    if (len >= n) \
+      return len; \
+  } while (0)
+
+  if (len >= n)
+    return len;
+  if (t == NULL) {
+    APPEND("<error>");
+    return len;
+  }
+  switch (t->kind) {
+    case TYPE_INTEGER:
+      APPEND("integer");
+      break;
+    case TYPE_REAL:
+      APPEND("real");
+      break;
+    case TYPE_BOOLEAN:
+      APPEND("boolean");
+      break;
+    case TYPE_ARRAY:
+      APPEND("array[%d..%d] of ", t->low, t->high);
+      len = type_format_at(t->base, buf, n, len);
+      break;
+    case TYPE_FUNCTION:
+    case TYPE_PROCEDURE:
+      APPEND(t->kind == TYPE_FUNCTION ? "function(" : "procedure(");
+      for (unsigned int i = 0; i < t->argc && len < n; ++i) {
+        if (i > 0)
+          APPEND(", ");
+        len = type_format_at(t->args[i], buf, n, len);
+      }
+      APPEND(")");
+      if (t->kind == TYPE_FUNCTION) {
+        APPEND(": ");
+        len = type_format_at(t->base, buf, n, len);
+      }
+      break;
+  }
+  return len;
+#undef APPEND
+}
+
+// Write a type the way it would be spelled in a source into buf
+char *type_format(const type *t, char *buf, size_t n) {
+  if (n == 0)
+    return buf;
+  buf[0] = '\0';
+  type_format_at(t, buf, n, 0);
+  return buf;
+}
@@ -0,0 +1,88 @@
+#ifndef TYPE_H
+#define TYPE_H
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include "arena.h"
+
+/*
+ * Hash-consed types. Every distinct type is built exactly once per pool, so two
+ * types are the same exactly when their pointers are. Composite types only point
+ * at types that are already unique, which means building one only has to look at
+ * its immediate parts, and checking an expression never allocates or walks a type
+ */
+
+// What a type is
+typedef enum TypeKind {
+    TYPE_INTEGER,
+    TYPE_REAL,
+    // Never written in a source, only produced by relational operators and not
+    TYPE_BOOLEAN,
+    TYPE_ARRAY,
+    TYPE_FUNCTION,
+    TYPE_PROCEDURE,
+} type_kind;
+
+// A single unique type. Never build one of these by hand, get them out of a type_pool
+typedef struct Type {
+    type_kind kind;
+    unsigned long hash;
+    // TYPE_ARRAY bounds
+    int low;
+    int high;
+    // TYPE_ARRAY element type or TYPE_FUNCTION result type
+    const struct Type *base;
+    // TYPE_FUNCTION and TYPE_PROCEDURE parameter types, in order
+    unsigned int argc;
+    const struct Type *args[];
+} type;
+
+// Every type of one compilation
+typedef struct TypePool {
+    // Open addressing table of every composite type
+    type **slots;
+    unsigned int cap;
+    unsigned int len;
+    // Where the types themselves live
+    arena *types;
+    // The types with no parts are made up front
+    const type *integer;
+    const type *real;
+    const type *boolean;
+} type_pool;
+
+// Create a new type pool
+type_pool *type_pool_new();
+
+// Delete a type pool and every type inside it
+void type_pool_del(type_pool *p);
+
+// Get the type array[low..high] of elem
+const type *type_array(type_pool *p, int low, int high, const type *elem);
+
+// Get the type of a function taking argc parameters of the given types and returning result
+const type *type_function(type_pool *p, const type *result, const type **args, unsigned int argc);
+
+// Get the type of a procedure taking argc parameters of the given types
+const type *type_procedure(type_pool *p, const type **args, unsigned int argc);
+
+// Check if two types from the same pool are the same type
+static inline bool type_eq(const type *a, const type *b) {
+  return a == b;
+}
+
+// Check if a type is integer or real
+static inline bool type_is_number(const type *t) {
+  return t != NULL && (t->kind == TYPE_INTEGER || t->kind == TYPE_REAL);
+}
+
+// Check if a type is something that can be called
+static inline bool type_is_callable(const type *t) {
+  return t != NULL && (t->kind == TYPE_FUNCTION || t->kind == TYPE_PROCEDURE);
+}
+
+// Write a type the way it would be spelled in a source into buf, for diagnostics.
+// Long types get cut off at n - 1 characters. Returns buf
+char *type_format(const type *t, char *buf, size_t n);
+
+#endif
@@ -27,6 +27,7 @@ void vec_del(vec *v) {
     // Remove the element if it's on the heap
     v->del(*(v->data+i));
   }
+  free(v->data);
   free(v);
 }
 
@@ -50,12 +51,13 @@ void *vec_grow_array(void *a, size_t size, unsigned int *capacity, unsigned int
 int vec_grow(vec *v, unsigned int capacity) {
   v->cap += capacity;
   void **p;
-  if ((p = realloc(v->data, (sizeof(ptrdiff_t) * v->cap)+1)) == NULL) {
+  // Always keep room for the null on the end
+  if ((p = realloc(v->data, sizeof(ptrdiff_t) * (v->cap + 1))) == NULL) {
     v->cap -= capacity;
     return -1;
   }
   // Make sure to set the last value to 0
-  v->data[v->cap] = NULL;
+  p[v->cap] = NULL;
   // Assign the new array
   v->data = p;
   return 0;
@@ -64,16 +66,17 @@ int vec_grow(vec *v, unsigned int capacity) {
 // Shrink the vec by the capacity specified. Returns -1 if it failed
 int vec_shrink(vec *v, unsigned int capacity) {
   // Set capacity to no smaller than the length
-  v->cap = (v->cap - capacity < v->len) ? v->len : v->cap - capacity;
+  unsigned int prev_cap = v->cap;
+  v->cap = (capacity >= v->cap || v->cap - capacity < v->len) ? v->len : v->cap - capacity;
 
   void **p;
-  if ((p = realloc(v->data, (sizeof(ptrdiff_t) * v->cap)+1)) == NULL) {
-    v->cap += capacity;
+  if ((p = realloc(v->data, sizeof(ptrdiff_t) * (v->cap + 1))) == NULL) {
+    v->cap = prev_cap;
     return -1;
   }
 
   // Make sure to set the last value to 0
-  v->data[v->cap] = NULL;
+  p[v->cap] = NULL;
   // Assign the new array
   v->data = p;
   return 0;
@@ -86,14 +89,13 @@ int vec_set_cap(vec *v, unsigned int capacity) {
   v->cap = (capacity < v->len) ? v->len : capacity;
 
   void **p;
-  if ((p = realloc(v->data, (sizeof(ptrdiff_t) * v->cap)+1)) == NULL) {
+  if ((p = realloc(v->data, sizeof(ptrdiff_t) * (v->cap + 1))) == NULL) {
     v->cap = prev_cap;
     return -1;
   }
-//  memset()
 
   // Make sure to set the last value to 0
-  v->data[v->cap] = NULL;
+  p[v->cap] = NULL;
   // Assign the new array
   v->data = p;
   return 0;
@@ -118,22 +120,38 @@ int vec_find_with(const vec *v, const void *e, int (*cmp)(const void *a, const v
   return -1;
 }
 
-// Insert element after index into vector
+// Find the first element in the vec
+// Returns -1 if nothing was found
+int vec_find(const vec *v, const void *e) {
+  return vec_find_with(v, e, v->cmp);
+}
+
+// Insert element at index into vector, shifting everything after it up one
 // Returns -1 if failed
 int vec_insert(vec *v, const unsigned int index, void *e) {
+  if (index > v->len)
+    return -1;
   if (v->len == v->cap) {
-    if (vec_grow(v, v->cap*2) == -1) {
+    // Double the capacity
+    if (vec_grow(v, v->cap == 0 ? 1 : v->cap) == -1) {
       return -1;
     }
   }
-  // Increase vector length and add element
-  v->data[v->len++] = e;
+  // Make room and add element
+  memmove(v->data + index + 1, v->data + index, sizeof(ptrdiff_t) * (v->len - index));
+  v->data[index] = e;
+  ++v->len;
   return 0;
 }
 
-// Pops the element in the vector
+// Pops the element in the vector, shifting everything after it down one
 void *vec_pop(vec *v, unsigned int index) {
-//  v->
+  if (index >= v->len)
+    return NULL;
+  void *e = v->data[index];
+  memmove(v->data + index, v->data + index + 1, sizeof(ptrdiff_t) * (v->len - index - 1));
+  v->data[--v->len] = NULL;
+  return e;
 }
 
 // Reverses the vec in place
@@ -190,5 +208,5 @@ void vec_print(const vec *v, const char *format) {
 void vec_print_between(const vec *v, unsigned int i, unsigned int j, const char *format) {
   // Does not flip nodes if they are backwards unlike other function
   for (unsigned int idx = i; idx < j; ++idx)
-    printf(format, v->data[i]);
+    printf(format, v->data[idx]);
 }
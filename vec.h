@@ -56,7 +56,7 @@ void *vec_get(const vec *v, unsigned int index);
 int vec_find(const vec *v, const void *e);
 
 /* Insert into vec after specific node pointer */
-// Inserts item after index into vector
+// Inserts item at index into vector
 int vec_insert(vec *v, unsigned int index, void *e);
 // Add something to the end of the vec
 static inline int vec_push_back(vec *v, void *e) {